@@ -0,0 +1,151 @@
+/*
+ * Copyright (C) 2014 INRA
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __Benchmark_activity_hpp__
+#define __Benchmark_activity_hpp__
+
+#include "workload.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+
+namespace bench {
+
+/**
+ * @e Activity is the parameter of the sparse atomic models (the `activity'
+ * parameter), read from `key=value[,key=value...]':
+ * - stochastic models are imminent at each multiple of @e unit with the
+ *   probability @e ratio (geometric time advances), so about @e ratio of
+ *   the models are imminent at each event time.
+ * - periodic models fire every p * @e unit where p is one of the
+ *   @e periods first primes, chosen by model: the periods are co-prime and
+ *   the event times are the multiples of any of them.
+ * - bursty models fire @e burst_length times every @e burst_interval, then
+ *   wait an exponential gap of mean @e burst_gap.
+ * The generator of a model is seeded with @e seed, the partition and the
+ * identifier of the model.
+ */
+struct Activity
+{
+    double ratio = 0.01;
+    double unit = 1.0;
+    unsigned int periods = 8;
+    unsigned int burst_length = 10;
+    double burst_interval = 0.01;
+    double burst_gap = 10.0;
+    std::uint64_t seed = 0;
+
+    /**
+     * Read the keys ratio, unit, periods, burst-length, burst-interval,
+     * burst-gap and seed. Returns false on error.
+     */
+    bool parse(const std::string& spec)
+    {
+        std::size_t begin = 0;
+
+        while (begin < spec.size()) {
+            std::size_t end = spec.find(',', begin);
+            if (end == std::string::npos)
+                end = spec.size();
+
+            std::string token = spec.substr(begin, end - begin);
+            begin = end + 1;
+
+            std::size_t equal = token.find('=');
+            if (equal == std::string::npos)
+                return false;
+
+            std::string key = token.substr(0, equal);
+            const char *value = token.c_str() + equal + 1;
+            char *nptr;
+            double number = std::strtod(value, &nptr);
+            if (nptr == value || *nptr != '\0' || number <= 0.0)
+                return false;
+
+            if (key == "ratio")
+                ratio = std::min(number, 1.0);
+            else if (key == "unit")
+                unit = number;
+            else if (key == "periods")
+                periods = std::max(1u, std::min(
+                                       static_cast <unsigned int>(number),
+                                       static_cast <unsigned int>(prime_number)));
+            else if (key == "burst-length")
+                burst_length = std::max(1u, static_cast <unsigned int>(number));
+            else if (key == "burst-interval")
+                burst_interval = number;
+            else if (key == "burst-gap")
+                burst_gap = number;
+            else if (key == "seed")
+                seed = static_cast <std::uint64_t>(number);
+            else
+                return false;
+        }
+
+        return true;
+    }
+
+    /** Time advance of a stochastic model. */
+    double stochastic(std::uint64_t& state) const
+    {
+        if (ratio >= 1.0)
+            return unit;
+
+        return unit * (1.0 + std::floor(std::log(random_uniform(state)) /
+                                        std::log1p(-ratio)));
+    }
+
+    /** Period of a periodic model. */
+    double period(std::uint64_t& state) const
+    {
+        static const unsigned int primes[prime_number] = {
+            2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37, 41, 43, 47, 53 };
+
+        return unit * primes[random_next(state) % periods];
+    }
+
+    /** Time advance of a bursty model, @e left: transitions left in the
+     * burst. */
+    double bursty(std::uint64_t& state, unsigned int& left) const
+    {
+        if (left > 0) {
+            left--;
+            return burst_interval;
+        }
+
+        left = burst_length - 1;
+
+        return -burst_gap * std::log(random_uniform(state));
+    }
+
+    static constexpr unsigned int prime_number = 16;
+};
+
+}
+
+#endif
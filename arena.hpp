@@ -0,0 +1,252 @@
+/*
+ * Copyright (C) 2014 INRA
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __Benchmark_arena_hpp__
+#define __Benchmark_arena_hpp__
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <new>
+#include <typeindex>
+#include <typeinfo>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace bench {
+
+/**
+ * @e Arena is a bump allocator for the objects of one type. Memory is
+ * taken from the global operator new by chunks of 64 KiB and released in
+ * bulk when the arena and all the objects allocated from it are released
+ * (the arena is reference counted: one reference for the owner, one for
+ * each living object).
+ */
+class Arena
+{
+public:
+    static Arena* make(std::size_t object_size)
+    {
+        return new Arena(object_size);
+    }
+
+    void* allocate()
+    {
+        if (m_chunks.empty() || m_used == m_per_chunk) {
+            void *chunk = ::operator new(m_object_size * m_per_chunk);
+            m_chunks.push_back(chunk);
+            m_used = 0;
+        }
+
+        acquire();
+
+        return static_cast <char*>(m_chunks.back()) + m_object_size * m_used++;
+    }
+
+    void acquire()
+    {
+        m_references.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void release()
+    {
+        if (m_references.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            delete this;
+    }
+
+    std::size_t size() const
+    {
+        return m_chunks.empty() ? 0 :
+            (m_chunks.size() - 1) * m_per_chunk + m_used;
+    }
+
+private:
+    Arena(std::size_t object_size)
+        : m_object_size(round(object_size))
+        , m_per_chunk(std::max <std::size_t>(1, (64u << 10) / m_object_size))
+        , m_used(0)
+        , m_references(1)
+    {}
+
+    ~Arena()
+    {
+        for (void *chunk : m_chunks)
+            ::operator delete(chunk);
+    }
+
+    static std::size_t round(std::size_t size)
+    {
+        const std::size_t align = alignof(std::max_align_t);
+
+        return (size + align - 1) / align * align;
+    }
+
+    std::vector <void*> m_chunks;
+    std::size_t m_object_size;
+    std::size_t m_per_chunk;
+    std::size_t m_used;
+    std::atomic <long int> m_references;
+};
+
+/**
+ * @e ArenaSet owns one @e Arena per model type. A coupled model owns an
+ * @e ArenaSet and makes it current (see @e ArenaScope) while it builds its
+ * children, so the factory allocates the children of a coupled model from
+ * contiguous memory.
+ */
+class ArenaSet
+{
+public:
+    ArenaSet() = default;
+    ArenaSet(const ArenaSet&) = delete;
+    ArenaSet& operator=(const ArenaSet&) = delete;
+
+    ~ArenaSet()
+    {
+        clear();
+    }
+
+    Arena& get(std::type_index type, std::size_t object_size)
+    {
+        auto it = m_arenas.find(type);
+        if (it == m_arenas.end())
+            it = m_arenas.emplace(type, Arena::make(object_size)).first;
+
+        return *it->second;
+    }
+
+    /** Drop the references of the owner: arenas are released with their
+     * last object. */
+    void clear()
+    {
+        for (auto& arena : m_arenas)
+            arena.second->release();
+
+        m_arenas.clear();
+    }
+
+    static ArenaSet*& current()
+    {
+        static thread_local ArenaSet *ret = nullptr;
+
+        return ret;
+    }
+
+private:
+    std::unordered_map <std::type_index, Arena*> m_arenas;
+};
+
+/** Makes @e set the current @e ArenaSet of the thread in a scope. */
+struct ArenaScope
+{
+    ArenaScope(ArenaSet *set)
+        : m_previous(ArenaSet::current())
+    {
+        ArenaSet::current() = set;
+    }
+
+    ~ArenaScope()
+    {
+        ArenaSet::current() = m_previous;
+    }
+
+private:
+    ArenaSet *m_previous;
+};
+
+/**
+ * @e ArenaAllocated gives to the model @e T a class-specific operator new
+ * and delete. Each object is preceded by a header that stores its arena
+ * (or nullptr for objects allocated on the heap), so the `delete' of the
+ * Echll's @e modelptr is the matching deleter of both allocations.
+ */
+template <typename T>
+struct ArenaAllocated
+{
+    static void* operator new(std::size_t size)
+    {
+        void *ptr = ::operator new(header + size);
+
+        *static_cast <Arena**>(ptr) = nullptr;
+
+        return static_cast <char*>(ptr) + header;
+    }
+
+    static void* operator new(std::size_t size, Arena& arena)
+    {
+        void *ptr = arena.allocate();
+        (void)size;
+
+        *static_cast <Arena**>(ptr) = &arena;
+
+        return static_cast <char*>(ptr) + header;
+    }
+
+    static void operator delete(void *ptr)
+    {
+        if (!ptr)
+            return;
+
+        void *block = static_cast <char*>(ptr) - header;
+        Arena *arena = *static_cast <Arena**>(block);
+
+        if (arena)
+            arena->release();
+        else
+            ::operator delete(block);
+    }
+
+    /* Called if the constructor throws. */
+    static void operator delete(void *ptr, Arena&)
+    {
+        operator delete(ptr);
+    }
+
+    static constexpr std::size_t header = alignof(std::max_align_t);
+};
+
+/**
+ * Allocate a @e T from the current @e ArenaSet if any, from the heap
+ * otherwise.
+ */
+template <typename T, typename... Args>
+T* arena_new(Args&&... args)
+{
+    ArenaSet *set = ArenaSet::current();
+
+    if (!set)
+        return new T(std::forward <Args>(args)...);
+
+    Arena& arena = set->get(std::type_index(typeid(T)),
+                            ArenaAllocated <T>::header + sizeof(T));
+
+    return new (arena) T(std::forward <Args>(args)...);
+}
+
+}
+
+#endif
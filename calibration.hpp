@@ -0,0 +1,229 @@
+/*
+ * Copyright (C) 2014 INRA
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __Benchmark_calibration_hpp__
+#define __Benchmark_calibration_hpp__
+
+#include "linpackc.hpp"
+#include "timer.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+namespace bench {
+
+/** The measures of the requests of @e requested ms. */
+struct CalibrationPoint
+{
+    double requested = 0.0;
+    std::vector <double> actual;
+
+    double percentile(double p) const
+    {
+        if (actual.empty())
+            return 0.0;
+
+        std::size_t rank = static_cast <std::size_t>(
+            p * static_cast <double>(actual.size() - 1) + 0.5);
+
+        return actual[std::min(rank, actual.size() - 1)];
+    }
+
+    double median() const
+    {
+        return percentile(0.5);
+    }
+
+    /** Fraction of the requests within @e tolerance (relative). */
+    double within(double tolerance) const
+    {
+        std::size_t nb = std::count_if(
+            actual.cbegin(), actual.cend(),
+            [this, tolerance](double value)
+            {
+                return std::abs(value - requested) <= tolerance * requested;
+            });
+
+        return actual.empty() ? 0.0 :
+            static_cast <double>(nb) / static_cast <double>(actual.size());
+    }
+};
+
+/**
+ * @e Calibration measures the actual duration of @e sleep_and_work for
+ * requests from 10 us to 100 ms (each size is repeated during about
+ * @e budget ms, at least 3 times) and fits the overshoot model
+ * actual = offset + slope * requested by least squares on the medians,
+ * weighted by 1 / requested^2 (i.e. on the relative errors). The smallest
+ * requests saturate at the cost of a dispatch (@e floor, the median of the
+ * smallest request): only the requests above twice the floor are fitted.
+ */
+struct Calibration
+{
+    std::vector <CalibrationPoint> points;
+    double offset = 0.0;
+    double slope = 1.0;
+    double floor = 0.0;
+
+    static std::vector <double> sizes()
+    {
+        return { 0.01, 0.03, 0.1, 0.3, 1.0, 3.0, 10.0, 30.0, 100.0 };
+    }
+
+    void measure(const std::vector <double>& requests, double budget = 20.0)
+    {
+        points.clear();
+
+        for (double requested : requests) {
+            CalibrationPoint point;
+            std::size_t nb = static_cast <std::size_t>(
+                std::min(200.0, std::max(3.0, budget / requested)));
+
+            point.requested = requested;
+            point.actual.resize(nb);
+
+            bench::sleep_and_work(requested);        /* warm-up */
+
+            for (double& actual : point.actual) {
+                bench::Timer timer(&actual);
+                bench::sleep_and_work(requested);
+            }
+
+            std::sort(point.actual.begin(), point.actual.end());
+            points.emplace_back(std::move(point));
+        }
+    }
+
+    void fit()
+    {
+        double sw = 0.0, sx = 0.0, sy = 0.0, sxx = 0.0, sxy = 0.0;
+        std::size_t nb = 0;
+
+        floor = points.empty() ? 0.0 : points.front().median();
+
+        for (const auto& point : points) {
+            if (point.requested < 2.0 * floor)
+                continue;
+
+            double x = point.requested;
+            double y = point.median();
+            double w = 1.0 / (x * x);
+
+            sw += w;
+            sx += w * x;
+            sy += w * y;
+            sxx += w * x * x;
+            sxy += w * x * y;
+            nb++;
+        }
+
+        double det = sw * sxx - sx * sx;
+        if (nb < 2 || det == 0.0) {
+            offset = 0.0;
+            slope = 1.0;
+            return;
+        }
+
+        slope = (sw * sxy - sx * sy) / det;
+        offset = (sy - slope * sx) / sw;
+    }
+
+    /**
+     * Writes the model, the requested versus actual durations of @e raw
+     * (without compensation) and of this calibration (with compensation)
+     * and the histogram of the relative errors of this calibration:
+     *   calibration;offset;slope;floor;tolerance
+     *   calibration-size;requested;raw-median;raw-p90;median;p90;error;within
+     *   calibration-residual;low;high;count
+     */
+    void print(FILE *output, const Calibration& raw, double tolerance) const
+    {
+        static const double bounds[] = { -0.5, -0.1, -0.05, -0.01, 0.01,
+                                         0.05, 0.1, 0.5 };
+        const std::size_t bound_number = sizeof(bounds) / sizeof(bounds[0]);
+        std::vector <std::size_t> histogram(bound_number + 1, 0);
+
+        std::fprintf(output, "calibration;%f;%f;%f;%f\n", raw.offset,
+                     raw.slope, raw.floor, tolerance);
+
+        for (std::size_t i = 0; i != points.size(); ++i) {
+            const auto& point = points[i];
+            const CalibrationPoint *before =
+                i < raw.points.size() ? &raw.points[i] : &point;
+
+            std::fprintf(output, "calibration-size;%f;%f;%f;%f;%f;%f;%f\n",
+                         point.requested, before->median(),
+                         before->percentile(0.9), point.median(),
+                         point.percentile(0.9),
+                         (point.median() - point.requested) / point.requested,
+                         point.within(tolerance));
+
+            for (double actual : point.actual) {
+                double error = (actual - point.requested) / point.requested;
+                std::size_t bin = std::upper_bound(bounds, bounds + bound_number,
+                                                   error) - bounds;
+                histogram[bin]++;
+            }
+        }
+
+        for (std::size_t i = 0; i != histogram.size(); ++i)
+            std::fprintf(output, "calibration-residual;%f;%f;%zu\n",
+                         i ? bounds[i - 1] : -INFINITY,
+                         i < bound_number ? bounds[i] : INFINITY,
+                         histogram[i]);
+    }
+};
+
+/**
+ * Calibrate @e sleep_and_work, install the compensation and print the
+ * report into @e output. Returns the compensated calibration with the
+ * floor of the installed model: the requests below it are spun.
+ */
+inline Calibration sleep_and_work_calibrate(FILE *output, double tolerance,
+                                            double budget = 20.0)
+{
+    Calibration raw, compensated;
+
+    sleep_and_work_compensation(0.0, 1.0, 0.0);
+    raw.measure(Calibration::sizes(), budget);
+    raw.fit();
+
+    sleep_and_work_compensation(raw.offset, raw.slope, raw.floor);
+    compensated.measure(Calibration::sizes(), budget);
+    compensated.fit();
+
+    if (output)
+        compensated.print(output, raw, tolerance);
+
+    compensated.floor = raw.floor;
+
+    return compensated;
+}
+
+}
+
+#endif
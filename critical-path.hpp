@@ -0,0 +1,323 @@
+/*
+ * Copyright (C) 2014 INRA
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __Benchmark_critical_path_hpp__
+#define __Benchmark_critical_path_hpp__
+
+#include "tgf.hpp"
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace bench {
+
+/**
+ * @e CostRecorder stores, for each atomic model, the wall time in
+ * millisecond of each of its firing transitions. Models get their slot in
+ * @e init (the only place where a mutex is locked) and then append costs
+ * without any synchronization: a slot is written by one model only.
+ */
+struct CostRecorder
+{
+    std::vector <double>* slot(const std::string& name)
+    {
+        std::lock_guard <std::mutex> lock(m_mutex);
+
+        std::vector <double>* ret = &m_costs[name];
+        ret->clear();
+
+        return ret;
+    }
+
+    void clear()
+    {
+        std::lock_guard <std::mutex> lock(m_mutex);
+
+        m_costs.clear();
+    }
+
+    std::map <std::string, std::vector <double>> m_costs;
+    std::mutex m_mutex;
+};
+
+/**
+ * @e CostProbe measures the wall time of a transition and adds it to the
+ * cost of the current firing of the model. When the transition is the
+ * firing one (see @e fire), the accumulated cost is appended to the slot.
+ * It does nothing if the model has no @e CostRecorder slot.
+ */
+struct CostProbe
+{
+    CostProbe(std::vector <double> *slot, double *pending)
+        : m_slot(slot)
+        , m_pending(pending)
+        , m_fire(false)
+    {
+        if (m_slot)
+            m_start = std::chrono::steady_clock::now();
+    }
+
+    void fire()
+    {
+        m_fire = true;
+    }
+
+    ~CostProbe()
+    {
+        if (!m_slot)
+            return;
+
+        *m_pending += std::chrono::duration <double, std::milli>(
+            std::chrono::steady_clock::now() - m_start).count();
+
+        if (m_fire) {
+            m_slot->push_back(*m_pending);
+            *m_pending = 0.0;
+        }
+    }
+
+private:
+    std::vector <double> *m_slot;
+    double *m_pending;
+    bool m_fire;
+    std::chrono::steady_clock::time_point m_start;
+};
+
+/**
+ * @e CriticalPath computes, for each simulation step, the ideal parallel
+ * time of the flattened model graph. In a step, `top' models fire first and
+ * a `normal' model fires when all its neighbours have sent their message,
+ * so a step is a DAG weighted by the transition costs.
+ *
+ * - work: the sum of the costs (the sequential time).
+ * - span: the critical path of the DAG (the time with infinite cores).
+ * - level_span: the sum, over the DAG levels, of the most expensive
+ *   transition. This is the ideal time of an engine that synchronizes all
+ *   the transitions of a bag before routing, like the DSDE engine.
+ * - bound(P): the Brent's lower bound max(work / P, span).
+ */
+struct CriticalPath
+{
+    struct Step
+    {
+        double work = 0.0;
+        double span = 0.0;
+        double level_span = 0.0;
+        std::size_t levels = 0;
+        std::size_t max_width = 0;
+
+        double parallelism() const
+        {
+            return span > 0.0 ? work / span : 0.0;
+        }
+
+        double bound(unsigned long int p) const
+        {
+            return std::max(work / static_cast <double>(p), span);
+        }
+    };
+
+    std::vector <Step> steps;
+
+    double work() const
+    {
+        double ret = 0.0;
+        for (const auto& step : steps)
+            ret += step.work;
+        return ret;
+    }
+
+    double span() const
+    {
+        double ret = 0.0;
+        for (const auto& step : steps)
+            ret += step.span;
+        return ret;
+    }
+
+    double level_span() const
+    {
+        double ret = 0.0;
+        for (const auto& step : steps)
+            ret += step.level_span;
+        return ret;
+    }
+
+    std::size_t max_width() const
+    {
+        std::size_t ret = 0;
+        for (const auto& step : steps)
+            ret = std::max(ret, step.max_width);
+        return ret;
+    }
+
+    double parallelism() const
+    {
+        double s = span();
+        return s > 0.0 ? work() / s : 0.0;
+    }
+
+    /** Steps are sequential: the bound is the sum of the step bounds. */
+    double bound(unsigned long int p) const
+    {
+        double ret = 0.0;
+        for (const auto& step : steps)
+            ret += step.bound(p);
+        return ret;
+    }
+
+    double speedup(unsigned long int p) const
+    {
+        double b = bound(p);
+        return b > 0.0 ? work() / b : 0.0;
+    }
+
+    /**
+     * Add the steps of the replicate @e other, step by step, to compute
+     * the mean of the replicates with @e divide. The widths and the levels
+     * are the largest ones.
+     */
+    void add(const CriticalPath& other)
+    {
+        if (steps.size() < other.steps.size())
+            steps.resize(other.steps.size());
+
+        for (std::size_t k = 0, e = other.steps.size(); k != e; ++k) {
+            steps[k].work += other.steps[k].work;
+            steps[k].span += other.steps[k].span;
+            steps[k].level_span += other.steps[k].level_span;
+            steps[k].levels = std::max(steps[k].levels, other.steps[k].levels);
+            steps[k].max_width = std::max(steps[k].max_width,
+                                          other.steps[k].max_width);
+        }
+    }
+
+    void divide(std::size_t runs)
+    {
+        if (runs == 0)
+            return;
+
+        for (auto& step : steps) {
+            step.work /= static_cast <double>(runs);
+            step.span /= static_cast <double>(runs);
+            step.level_span /= static_cast <double>(runs);
+        }
+    }
+};
+
+/**
+ * Compute the @e CriticalPath of @e topology using the costs recorded in
+ * @e recorder. Models without recorded cost for a step use @e
+ * default_cost (the `-d' duration). If @e recorder is empty, @e steps
+ * steps of uniform @e default_cost are analyzed.
+ *
+ * @exception std::invalid_argument if the topology has a cycle of `normal'
+ * models: such a topology never fires.
+ */
+inline CriticalPath critical_path(const Topology& topology,
+                                  const CostRecorder& recorder,
+                                  double default_cost,
+                                  std::size_t steps)
+{
+    const std::size_t size = topology.vertices.size();
+    std::vector <const std::vector <double>*> costs(size, nullptr);
+
+    for (std::size_t i = 0; i != size; ++i) {
+        auto it = recorder.m_costs.find(topology.vertices[i].name);
+        if (it != recorder.m_costs.end()) {
+            costs[i] = &it->second;
+            steps = std::max(steps, it->second.size());
+        }
+    }
+
+    /* Topological order and level of each vertex. */
+    std::vector <int> order = topological_order(topology);
+    std::vector <std::size_t> level(size, 0);
+
+    if (order.size() != size)
+        throw std::invalid_argument("critical path: the topology has a"
+                                    " cycle");
+
+    for (int v : order)
+        for (int dst : topology.vertices[v].out)
+            level[dst] = std::max(level[dst], level[v] + 1);
+
+    std::size_t levels = 0;
+    for (std::size_t i = 0; i != size; ++i)
+        levels = std::max(levels, level[i] + 1);
+
+    CriticalPath ret;
+    ret.steps.resize(steps);
+    std::vector <double> finish(size);
+    std::vector <double> level_cost(levels);
+    std::vector <std::size_t> level_width(levels);
+
+    for (std::size_t k = 0; k != steps; ++k) {
+        CriticalPath::Step& step = ret.steps[k];
+        std::fill(finish.begin(), finish.end(), 0.0);
+        std::fill(level_cost.begin(), level_cost.end(), 0.0);
+        std::fill(level_width.begin(), level_width.end(), 0);
+
+        for (int v : order) {
+            double cost = default_cost;
+            if (costs[v])
+                cost = k < costs[v]->size() ? (*costs[v])[k] : 0.0;
+
+            /* A model without input never receives message: only the
+             * sources, i.e. `top' models, fire. */
+            if (topology.vertices[v].in == 0 &&
+                topology.vertices[v].type != "top")
+                continue;
+
+            finish[v] += cost;
+            step.work += cost;
+            step.span = std::max(step.span, finish[v]);
+            level_cost[level[v]] = std::max(level_cost[level[v]], cost);
+            level_width[level[v]]++;
+
+            for (int dst : topology.vertices[v].out)
+                finish[dst] = std::max(finish[dst], finish[v]);
+        }
+
+        for (std::size_t l = 0; l != levels; ++l) {
+            if (level_width[l]) {
+                step.level_span += level_cost[l];
+                step.levels++;
+                step.max_width = std::max(step.max_width, level_width[l]);
+            }
+        }
+    }
+
+    return ret;
+}
+
+}
+
+#endif
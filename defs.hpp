@@ -47,6 +47,8 @@ typedef int Data;
 typedef vle::dsde::Engine <Time, Data> DSDE;
 typedef vle::dsde::Factory <Time, Data> Factory;
 
+using Model = vle::dsde::Model <Time, Data>;
+
 using AtomicModel = vle::dsde::AtomicModel <Time, Data>;
 
 using GenericCoupledModelThread = vle::dsde::GenericCoupledModel <Time, Data,
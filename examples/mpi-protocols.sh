@@ -0,0 +1,70 @@
+#!/bin/sh
+#
+# MPI protocol comparison: runs the tree and linked examples with one rank
+# per sub-coupled model (plus rank 0) with each synchronization protocol
+# and prints the mpi, mpi-overhead, mpi-window, mpi-traffic,
+# mpi-serialization, mpi-transport and mpi-sync lines of each run (the
+# protocol column of the mpi line is the -u argument) and the speedup of
+# each protocol over the synchronous one:
+#
+#   example;mpi;protocol;ranks;partitions;wall
+#   example;mpi-overhead;events;packets;null-messages;null-ratio;
+#     null-per-event
+#   example;mpi-window;windows;windows-per-time-unit;mean-window;
+#     sync-us-per-window
+#   example;mpi-traffic;rank;sends;bytes;bytes-per-send;wait;
+#     overlapped-events;shared-sends
+#   example;mpi-serialization;format;packets;bytes;serialization;
+#     us-per-packet;mb-per-s
+#   example;mpi-transport;transport;bytes;latency-us;mb-per-s
+#   example;mpi-sync;layout;ranks;fanout;latency-us
+#   example;speedup;protocol;speedup
+#
+# Usage: mpi-protocols.sh [-b benchmark] [-c counter] [-s steps]
+#                         [-d duration] [-p "protocol..."]
+#                         [example-directory...]
+
+benchmark=Echll-benchmark
+counter=5
+steps=100
+duration=0
+protocols="synchronous null-message window aggregated
+    aggregated,transport=shm"
+lines='^mpi(-overhead|-window|-traffic|-serialization|-transport|-sync)?;'
+
+while getopts "b:c:s:d:p:" opt; do
+    case $opt in
+        b) benchmark=$OPTARG ;;
+        c) counter=$OPTARG ;;
+        s) steps=$OPTARG ;;
+        d) duration=$OPTARG ;;
+        p) protocols=$OPTARG ;;
+        *) sed -n '3,25p' "$0"; exit 1 ;;
+    esac
+done
+shift $((OPTIND - 1))
+
+cd "$(dirname "$0")" || exit 1
+
+if [ $# -eq 0 ]; then
+    set -- tree_5000_2 tree_5000_8 tree_20000_4 tree_20000_8 \
+        linked_2000_2 linked_2000_4 linked_10000_4 linked_10000_8
+fi
+
+for example in "$@"; do
+    name=$(basename "$example")
+    ranks=$(($(sed -n '/^#/q;p' "$example/root.tgf" | grep -c .) + 1))
+    for protocol in $protocols; do
+        (cd "$example" && mpirun -np "$ranks" "$benchmark" -q 0 \
+            -d "$duration" -c "$counter" -s "0,$steps" -u "$protocol" \
+            root.tgf) | \
+            grep -E "$lines" | \
+            sed "s/^/$name;/; s/^\($name;mpi;\)[^;]*/\1$protocol/"
+    done | tee /tmp/mpi-protocols.$$ | grep -v '^$'
+    awk -F';' '$2 == "mpi" { wall[$3] = $6 }
+        END { for (p in wall) if (p != "synchronous" && wall[p] > 0)
+                  printf "%s;speedup;%s;%f\n", name, p,
+                      wall["synchronous"] / wall[p] }' \
+        name="$name" /tmp/mpi-protocols.$$
+    rm -f /tmp/mpi-protocols.$$
+done
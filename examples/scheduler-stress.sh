@@ -0,0 +1,41 @@
+#!/bin/sh
+#
+# Scheduler stress preset: runs the largest examples without workload
+# (-d 0) for each thread mode and prints the throughput line of each run:
+#
+#   example;mode;throughput;transitions;external-events;messages;steps;
+#     simulation;events-per-s;messages-per-s;ns-per-transition
+#
+# Usage: scheduler-stress.sh [-b benchmark] [-c counter] [-s steps]
+#                            [-n thread_number] [example-directory...]
+
+benchmark=Echll-benchmark
+counter=10
+steps=100
+threads=
+
+while getopts "b:c:s:n:" opt; do
+    case $opt in
+        b) benchmark=$OPTARG ;;
+        c) counter=$OPTARG ;;
+        s) steps=$OPTARG ;;
+        n) threads="-n $OPTARG" ;;
+        *) sed -n '3,10p' "$0"; exit 1 ;;
+    esac
+done
+shift $((OPTIND - 1))
+
+cd "$(dirname "$0")" || exit 1
+
+if [ $# -eq 0 ]; then
+    set -- tree_20000_16 tree_20000_8 tree_20000_4 linked_10000_8 \
+        linked_10000_4 grid_4000_2
+fi
+
+for example in "$@"; do
+    for mode in 0 1 2 3; do
+        line=$(cd "$example" && "$benchmark" -q 0 -d 0 -c "$counter" \
+            -s "0,$steps" -t "$mode" $threads root.tgf | grep '^throughput;')
+        echo "$(basename "$example");$mode;$line"
+    done
+done
@@ -0,0 +1,52 @@
+#!/bin/sh
+#
+# Sparse graph generator: writes in a directory the root.tgf and s*.tgf
+# files of a model of `partitions' sub-coupled models of `models' atomic
+# models of the type `type' (stochastic, periodic or bursty). Each model
+# sends to the next one of its sub-coupled model (a ring). Run it with the
+# activity parameters of the -x option, for example 1% of 1M models
+# imminent at each step:
+#
+#   sparse-graph.sh -p 16 -m 62500 sparse_1M
+#   (cd sparse_1M && Echll-benchmark -d 0 -t 3 -x ratio=0.01 root.tgf)
+#
+# Usage: sparse-graph.sh [-p partitions] [-m models] [-t type] directory
+
+partitions=4
+models=1000
+type=stochastic
+
+while getopts "p:m:t:" opt; do
+    case $opt in
+        p) partitions=$OPTARG ;;
+        m) models=$OPTARG ;;
+        t) type=$OPTARG ;;
+        *) sed -n '3,14p' "$0"; exit 1 ;;
+    esac
+done
+shift $((OPTIND - 1))
+
+if [ $# -ne 1 ]; then
+    sed -n '3,14p' "$0"
+    exit 1
+fi
+
+mkdir -p "$1" || exit 1
+
+awk -v partitions="$partitions" 'BEGIN {
+    for (i = 0; i < partitions; i++)
+        print "coupled";
+    print "#";
+}' > "$1/root.tgf"
+
+i=0
+while [ $i -lt "$partitions" ]; do
+    awk -v models="$models" -v type="$type" 'BEGIN {
+        for (i = 0; i < models; i++)
+            print type;
+        print "#";
+        for (i = 0; i < models && models > 1; i++)
+            print i + 1, (i + 1) % models + 1, 0, 0;
+    }' > "$1/s$i.tgf"
+    i=$((i + 1))
+done
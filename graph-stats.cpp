@@ -0,0 +1,119 @@
+/*
+ * Copyright (C) 2014 INRA
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "graph-stats.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static void graph_help() noexcept
+{
+    std::fprintf(stdout, "echll-benchmark-graph [-h][-d duration] root.tgf...\n\n"
+                 "Options:\n"
+                 "  -h          This help message.\n"
+                 "  -d duration The duration of a transition in milliseconds\n"
+                 "              for the predicted work (default 100, as\n"
+                 "              Echll-benchmark).\n"
+                 "  root.tgf    A root TGF file, read with its S*.tgf files,\n"
+                 "              or a directory with a root.tgf file.\n\n"
+                 "Prints, for each file (by step: one unit of simulated"
+                 " time):\n"
+                 "  graph;models;partitions;edges;cut-edges;cut-fraction;"
+                 "acyclic;\n"
+                 "    depth;diameter;components;largest-component;silent;"
+                 "partial;\n"
+                 "    firings;transitions;messages;cut-messages\n"
+                 "  graph-partition;partition;models;firings;transitions;"
+                 "internal;\n"
+                 "    in;out;messages;cut-messages;work;work-share\n"
+                 "  graph-type;partition;type;models\n"
+                 "  graph-cut;from;to;edges;messages\n"
+                 "  graph-degree;in|out;degree;models\n"
+                 "where partition -1 is the root, silent the models that"
+                 " never fire and\npartial the models fired at a rate"
+                 " below 1 (the simulation fails).\n");
+}
+
+int main(int argc, char *argv[])
+{
+    double duration = 100.0;
+    int opt;
+
+    while ((opt = ::getopt(argc, argv, "hd:")) != -1) {
+        switch (opt) {
+        case 'h':
+            graph_help();
+            return EXIT_SUCCESS;
+        case 'd':
+            {
+                char *nptr;
+                duration = std::strtod(::optarg, &nptr);
+                if (nptr == ::optarg || *nptr != '\0' || duration < 0.0) {
+                    std::fprintf(stderr, "Bad duration %s\n", ::optarg);
+                    return EXIT_FAILURE;
+                }
+                break;
+            }
+        default:
+            graph_help();
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (::optind >= argc) {
+        graph_help();
+        return EXIT_FAILURE;
+    }
+
+    for (int i = ::optind; i < argc; ++i) {
+        std::string filename(argv[i]);
+        struct stat st;
+
+        if (::stat(filename.c_str(), &st) == 0 && S_ISDIR(st.st_mode)) {
+            if (filename.back() != '/')
+                filename += '/';
+            filename += "root.tgf";
+        }
+
+        if (::stat(filename.c_str(), &st) != 0 || !S_ISREG(st.st_mode)) {
+            std::fprintf(stderr, "%s: not a TGF file\n", filename.c_str());
+            return EXIT_FAILURE;
+        }
+
+        try {
+            bench::graph_stats(bench::topology_read(filename))
+                .print(stdout, duration);
+        } catch (const std::exception& e) {
+            std::fprintf(stderr, "%s\n", e.what());
+            return EXIT_FAILURE;
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,380 @@
+/*
+ * Copyright (C) 2014 INRA
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __Benchmark_graph_stats_hpp__
+#define __Benchmark_graph_stats_hpp__
+
+#include "tgf.hpp"
+#include <algorithm>
+#include <cinttypes>
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace bench {
+
+/**
+ * @e GraphStats describes the work asked to the engine by a @e Topology
+ * before running it. The firing rates (firings by step) follow the
+ * semantics of the models: a `top' model fires once by step, a `normal'
+ * model fires each time it has received as many messages as it has input
+ * connections, i.e. at the mean rate of its sources; a model without input
+ * or fed by a cycle never fires. A firing sends one message on each output
+ * connection. A model fired at a rate strictly between 0 and 1 (a source
+ * that never fires) fails the check of the received messages at the end of
+ * the simulation. The zero-duration messages of a step are delivered level
+ * by level: a model has one external transition by distinct level of its
+ * firing sources, and the depth is the number of levels.
+ */
+struct GraphStats
+{
+    struct Partition
+    {
+        std::size_t models = 0;
+        double firings = 0.0;           /* by step. */
+        double transitions = 0.0;       /* by step. */
+        std::size_t internal = 0;       /* connections inside. */
+        std::size_t in = 0;             /* connections from the others. */
+        std::size_t out = 0;            /* connections to the others. */
+        double messages = 0.0;          /* sent by step. */
+        double cut_messages = 0.0;      /* sent to the others by step. */
+        std::map <std::string, std::size_t> types;
+    };
+
+    struct Cut
+    {
+        std::size_t edges = 0;
+        double messages = 0.0;          /* by step. */
+    };
+
+    std::size_t models = 0;
+    std::size_t edges = 0;
+    std::size_t cut_edges = 0;
+    std::size_t silent = 0;             /* models that never fire. */
+    std::size_t partial = 0;            /* fire at a rate in ]0, 1[. */
+    double firings = 0.0;
+    double transitions = 0.0;
+    double messages = 0.0;
+    double cut_messages = 0.0;
+    std::size_t depth = 0;              /* levels of a step. */
+    std::size_t diameter = 0;           /* lower bound, undirected. */
+    std::size_t components = 0;         /* weakly connected. */
+    std::size_t largest_component = 0;
+    bool acyclic = true;
+
+    /* Index 0 is the root (partition -1), index p + 1 the partition p. */
+    std::vector <Partition> partitions;
+    std::map <std::pair <int, int>, Cut> cuts;
+    std::map <std::size_t, std::size_t> in_degree;
+    std::map <std::size_t, std::size_t> out_degree;
+
+    /**
+     * Write the lines `graph', `graph-partition', `graph-type',
+     * `graph-cut' and `graph-degree'. The work of a partition is its
+     * firings by step times @e duration (milliseconds). The root is
+     * written only if it has atomic models.
+     */
+    void print(FILE *out, double duration) const
+    {
+        std::fprintf(out, "graph;%zu;%zu;%zu;%zu;%f;%d;%zu;%zu;%zu;%zu;%zu;"
+                     "%zu;%f;%f;%f;%f\n",
+                     models, partitions.size() - 1, edges, cut_edges,
+                     edges ? static_cast <double>(cut_edges) /
+                     static_cast <double>(edges) : 0.0,
+                     acyclic, depth, diameter, components, largest_component,
+                     silent, partial, firings, transitions, messages,
+                     cut_messages);
+
+        for (std::size_t p = 0, e = partitions.size(); p != e; ++p) {
+            const Partition& partition = partitions[p];
+
+            if (p == 0 && partition.models == 0)
+                continue;
+
+            std::fprintf(out, "graph-partition;%d;%zu;%f;%f;%zu;%zu;%zu;"
+                         "%f;%f;%f;%f\n",
+                         static_cast <int>(p) - 1, partition.models,
+                         partition.firings, partition.transitions,
+                         partition.internal, partition.in, partition.out,
+                         partition.messages, partition.cut_messages,
+                         partition.firings * duration,
+                         firings > 0.0 ? partition.firings / firings : 0.0);
+        }
+
+        for (std::size_t p = 0, e = partitions.size(); p != e; ++p)
+            for (const auto& type : partitions[p].types)
+                std::fprintf(out, "graph-type;%d;%s;%zu\n",
+                             static_cast <int>(p) - 1, type.first.c_str(),
+                             type.second);
+
+        for (const auto& cut : cuts)
+            std::fprintf(out, "graph-cut;%d;%d;%zu;%f\n", cut.first.first,
+                         cut.first.second, cut.second.edges,
+                         cut.second.messages);
+
+        for (const auto& degree : in_degree)
+            std::fprintf(out, "graph-degree;in;%zu;%zu\n", degree.first,
+                         degree.second);
+
+        for (const auto& degree : out_degree)
+            std::fprintf(out, "graph-degree;out;%zu;%zu\n", degree.first,
+                         degree.second);
+    }
+};
+
+/**
+ * Compute the @e GraphStats of @e topology in time linear in the number of
+ * connections: a topological order for the firing rates and the levels, a
+ * bucket sort of the levels for the external transitions and breadth
+ * first searches for the components and the diameter (double sweep from
+ * the largest component, a lower bound of the undirected diameter).
+ */
+inline GraphStats graph_stats(const Topology& topology)
+{
+    const std::size_t size = topology.vertices.size();
+    GraphStats ret;
+
+    ret.models = size;
+    ret.edges = topology.edges;
+    ret.cut_edges = topology.cut_edges;
+    ret.partitions.resize(topology.partitions() + 1);
+
+    /* Topological order, firing rates and levels. The rate of a `normal'
+     * model is the sum of the rates of its sources by input. */
+    std::vector <int> order = topological_order(topology);
+    std::vector <double> rate(size, 0.0);
+    std::vector <std::size_t> level(size, 0);
+
+    for (int v : order) {
+        const Topology::Vertex& vertex = topology.vertices[v];
+
+        if (vertex.type == "top")
+            rate[v] = 1.0;
+        else if (vertex.in)
+            rate[v] /= static_cast <double>(vertex.in);
+
+        for (int dst : vertex.out) {
+            rate[dst] += rate[v];
+            if (rate[v] > 0.0)
+                level[dst] = std::max(level[dst], level[v] + 1);
+        }
+    }
+
+    /* The models of a cycle, missing from the order, wait for
+     * themselves. */
+    ret.acyclic = order.size() == size;
+    if (!ret.acyclic) {
+        std::vector <char> ordered(size, 0);
+
+        for (int v : order)
+            ordered[v] = 1;
+        for (std::size_t v = 0; v != size; ++v)
+            if (!ordered[v])
+                rate[v] = 0.0;
+    }
+
+    for (int v : order)
+        if (rate[v] > 0.0)
+            ret.depth = std::max(ret.depth, level[v] + 1);
+
+    /* External transitions: the distinct levels of the firing sources,
+     * visited level by level, at the highest rate of the level. */
+    std::vector <double> external(size, 0.0);
+    {
+        std::vector <std::size_t> first(ret.depth + 1, 0);
+        std::vector <int> by_level(size);
+        std::vector <std::size_t> last(size, static_cast <std::size_t>(-1));
+        std::vector <double> pending(size, 0.0);
+        std::size_t firing = 0;
+
+        for (int v : order)
+            if (rate[v] > 0.0)
+                first[level[v] + 1]++;
+        for (std::size_t l = 0; l != ret.depth; ++l)
+            first[l + 1] += first[l];
+        for (int v : order) {
+            if (rate[v] > 0.0) {
+                by_level[first[level[v]]++] = v;
+                firing++;
+            }
+        }
+
+        for (std::size_t i = 0; i != firing; ++i) {
+            int v = by_level[i];
+
+            for (int dst : topology.vertices[v].out) {
+                if (last[dst] != level[v]) {
+                    external[dst] += pending[dst];
+                    pending[dst] = 0.0;
+                    last[dst] = level[v];
+                }
+                pending[dst] = std::max(pending[dst], rate[v]);
+            }
+        }
+
+        for (std::size_t v = 0; v != size; ++v)
+            external[v] += pending[v];
+    }
+
+    /* Per partition counts and cuts. */
+    for (std::size_t v = 0; v != size; ++v) {
+        const Topology::Vertex& vertex = topology.vertices[v];
+        GraphStats::Partition& partition = ret.partitions[vertex.partition + 1];
+        std::size_t out = vertex.out.size();
+
+        partition.models++;
+        partition.types[vertex.type]++;
+        partition.firings += rate[v];
+        partition.transitions += external[v] + rate[v];
+        partition.messages += rate[v] * static_cast <double>(out);
+        ret.in_degree[vertex.in]++;
+        ret.out_degree[out]++;
+
+        if (rate[v] == 0.0)
+            ret.silent++;
+        else if (rate[v] < 1.0)
+            ret.partial++;
+
+        for (int dst : vertex.out) {
+            int to = topology.vertices[dst].partition;
+
+            if (to == vertex.partition) {
+                partition.internal++;
+                continue;
+            }
+
+            GraphStats::Cut& cut = ret.cuts[std::make_pair(vertex.partition,
+                                                           to)];
+
+            partition.out++;
+            partition.cut_messages += rate[v];
+            ret.partitions[to + 1].in++;
+            cut.edges++;
+            cut.messages += rate[v];
+        }
+    }
+
+    for (const auto& partition : ret.partitions) {
+        ret.firings += partition.firings;
+        ret.transitions += partition.transitions;
+        ret.messages += partition.messages;
+        ret.cut_messages += partition.cut_messages;
+    }
+
+    /* Undirected graph (CSR), components and double sweep. */
+    std::vector <std::size_t> begin(size + 1, 0);
+    std::vector <int> adjacency;
+
+    for (std::size_t v = 0; v != size; ++v) {
+        for (int dst : topology.vertices[v].out) {
+            begin[v + 1]++;
+            begin[dst + 1]++;
+        }
+    }
+
+    for (std::size_t v = 0; v != size; ++v)
+        begin[v + 1] += begin[v];
+
+    adjacency.resize(begin[size]);
+
+    {
+        std::vector <std::size_t> next(begin.begin(), begin.end() - 1);
+
+        for (std::size_t v = 0; v != size; ++v) {
+            for (int dst : topology.vertices[v].out) {
+                adjacency[next[v]++] = dst;
+                adjacency[next[dst]++] = static_cast <int>(v);
+            }
+        }
+    }
+
+    const std::size_t unvisited = static_cast <std::size_t>(-1);
+    std::vector <std::size_t> distance(size, unvisited);
+    std::vector <int> queue;
+    queue.reserve(size);
+
+    /* Breadth first search from @e source over the unvisited vertices;
+     * returns the farthest vertex and its distance and leaves the visited
+     * vertices in @e queue. */
+    auto bfs = [&](int source)
+        {
+            std::pair <int, std::size_t> farthest(source, 0);
+
+            queue.clear();
+            queue.push_back(source);
+            distance[source] = 0;
+
+            for (std::size_t i = 0; i != queue.size(); ++i) {
+                int v = queue[i];
+
+                if (distance[v] > farthest.second)
+                    farthest = std::make_pair(v, distance[v]);
+
+                for (std::size_t j = begin[v]; j != begin[v + 1]; ++j) {
+                    int w = adjacency[j];
+
+                    if (distance[w] == unvisited) {
+                        distance[w] = distance[v] + 1;
+                        queue.push_back(w);
+                    }
+                }
+            }
+
+            return farthest;
+        };
+
+    int largest = -1;
+
+    for (std::size_t v = 0; v != size; ++v) {
+        if (distance[v] != unvisited)
+            continue;
+
+        bfs(static_cast <int>(v));
+        ret.components++;
+
+        if (queue.size() > ret.largest_component) {
+            ret.largest_component = queue.size();
+            largest = static_cast <int>(v);
+        }
+    }
+
+    if (largest >= 0) {
+        std::fill(distance.begin(), distance.end(), unvisited);
+        int far = bfs(largest).first;
+
+        std::fill(distance.begin(), distance.end(), unvisited);
+        ret.diameter = bfs(far).second;
+    }
+
+    return ret;
+}
+
+}
+
+#endif
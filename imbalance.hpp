@@ -0,0 +1,309 @@
+/*
+ * Copyright (C) 2014 INRA
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __Benchmark_imbalance_hpp__
+#define __Benchmark_imbalance_hpp__
+
+#include "profiler.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace bench {
+
+/**
+ * @e LoadReport sums by partition, in milliseconds, the busy time (the
+ * transitions of the atomic models, workload included), the routing time
+ * (the rest of the time of the sub-coupled model: outputs and bags of
+ * events) and the wait time (the partition has finished its part of the
+ * step and waits for the others). For each step, the imbalance factor is
+ * max / mean of the load (busy and routing) of the partitions and the
+ * straggler is the partition with the largest load.
+ */
+struct LoadReport
+{
+    struct Partition
+    {
+        double busy = 0.0;
+        double routing = 0.0;
+        double wait = 0.0;
+        std::uint64_t straggler = 0;    /* steps where it is the straggler. */
+    };
+
+    std::vector <Partition> partitions;
+    std::uint64_t steps = 0;
+    double factor = 0.0;                /* sum of the factors of the steps. */
+    double max_factor = 0.0;
+
+    Partition& at(std::size_t partition)
+    {
+        if (partitions.size() <= partition)
+            partitions.resize(partition + 1);
+
+        return partitions[partition];
+    }
+
+    void add(std::size_t partition, double busy, double routing, double wait)
+    {
+        Partition& p = at(partition);
+
+        p.busy += busy;
+        p.routing += routing;
+        p.wait += wait;
+    }
+
+    /** A step from the load of each partition. Steps without load are
+     * ignored. */
+    void step(const std::vector <double>& load)
+    {
+        double sum = 0.0, max = 0.0;
+        std::size_t straggler = 0;
+
+        for (std::size_t i = 0; i != load.size(); ++i) {
+            sum += load[i];
+            if (load[i] > max) {
+                max = load[i];
+                straggler = i;
+            }
+        }
+
+        if (sum <= 0.0)
+            return;
+
+        double f = max / (sum / static_cast <double>(load.size()));
+
+        steps++;
+        factor += f;
+        max_factor = std::max(max_factor, f);
+        at(straggler).straggler++;
+    }
+
+    void merge(const LoadReport& other)
+    {
+        for (std::size_t i = 0; i != other.partitions.size(); ++i) {
+            const Partition& o = other.partitions[i];
+            Partition& p = at(i);
+
+            p.busy += o.busy;
+            p.routing += o.routing;
+            p.wait += o.wait;
+            p.straggler += o.straggler;
+        }
+
+        steps += other.steps;
+        factor += other.factor;
+        max_factor = std::max(max_factor, other.max_factor);
+    }
+
+    /**
+     * Writes, from the totals of @e counter runs, the mean per run:
+     *   partition-load;partition;busy;routing;wait;straggler-steps
+     *   partition-imbalance;partitions;steps;mean-factor;max-factor;
+     *     overall-factor;straggler;straggler-share;wait-fraction
+     * where overall-factor is max / mean of the load of the partitions
+     * over the run, straggler the most frequent straggler (-1 without
+     * step) and wait-fraction the wait time over the total time of the
+     * partitions.
+     */
+    void print(FILE *output, long int counter) const
+    {
+        double n = static_cast <double>(std::max(1l, counter));
+        double sum = 0.0, max = 0.0, wait = 0.0, total = 0.0;
+        std::uint64_t straggler_steps = 0;
+        int straggler = -1;
+
+        for (std::size_t i = 0; i != partitions.size(); ++i) {
+            const Partition& p = partitions[i];
+            double load = p.busy + p.routing;
+
+            std::fprintf(output, "partition-load;%zu;%f;%f;%f;%f\n", i,
+                         p.busy / n, p.routing / n, p.wait / n,
+                         static_cast <double>(p.straggler) / n);
+
+            sum += load;
+            max = std::max(max, load);
+            wait += p.wait;
+            total += load + p.wait;
+
+            if (p.straggler > straggler_steps) {
+                straggler_steps = p.straggler;
+                straggler = static_cast <int>(i);
+            }
+        }
+
+        double mean = partitions.empty() ? 0.0 :
+            sum / static_cast <double>(partitions.size());
+
+        std::fprintf(output, "partition-imbalance;%zu;%f;%f;%f;%f;%d;%f;%f\n",
+                     partitions.size(), static_cast <double>(steps) / n,
+                     steps ? factor / static_cast <double>(steps) : 0.0,
+                     max_factor, mean > 0.0 ? max / mean : 0.0, straggler,
+                     steps ? static_cast <double>(straggler_steps) /
+                     static_cast <double>(steps) : 0.0,
+                     total > 0.0 ? wait / total : 0.0);
+    }
+};
+
+/**
+ * @e LoadStats measures the load of the partitions at each step of a run
+ * (the `partition-load' parameter). A sub-coupled model takes the slot of
+ * its partition and gives it to its children: the atomic models add the
+ * ticks of their transitions to @e busy, the sub-coupled model the ticks
+ * of its own lambda and delta to @e partition. The root closes each step
+ * with its duration: the slots are read and reset into the report.
+ */
+class LoadStats
+{
+public:
+    struct Slot
+    {
+        std::atomic <std::uint64_t> busy;
+        std::atomic <std::uint64_t> partition;
+
+        Slot()
+            : busy(0)
+            , partition(0)
+        {}
+    };
+
+    Slot* slot(int partition)
+    {
+        std::lock_guard <std::mutex> lock(m_mutex);
+
+        std::unique_ptr <Slot>& ret = m_slots[partition];
+        if (!ret)
+            ret.reset(new Slot());
+
+        return ret.get();
+    }
+
+    /** Close a step of @e ticks (the lambda and the delta of the root). */
+    void step(std::uint64_t ticks)
+    {
+        std::lock_guard <std::mutex> lock(m_mutex);
+        double wall = ProfileClock::milliseconds(ticks);
+
+        if (m_slots.empty())
+            return;
+
+        m_load.assign(static_cast <std::size_t>(
+                          std::max(0, m_slots.rbegin()->first + 1)), 0.0);
+
+        for (auto& slot : m_slots) {
+            if (slot.first < 0)
+                continue;
+
+            double busy = ProfileClock::milliseconds(
+                slot.second->busy.exchange(0, std::memory_order_relaxed));
+            double partition = ProfileClock::milliseconds(
+                slot.second->partition.exchange(0, std::memory_order_relaxed));
+
+            m_report.add(slot.first, busy, std::max(0.0, partition - busy),
+                         std::max(0.0, wall - partition));
+            m_load[slot.first] = partition;
+        }
+
+        m_report.step(m_load);
+    }
+
+    /** Busy time of @e partition in milliseconds since the last step. */
+    double busy(int partition)
+    {
+        return ProfileClock::milliseconds(slot(partition)->busy.load());
+    }
+
+    void clear()
+    {
+        std::lock_guard <std::mutex> lock(m_mutex);
+
+        for (auto& slot : m_slots) {
+            slot.second->busy.store(0);
+            slot.second->partition.store(0);
+        }
+
+        m_report = LoadReport();
+    }
+
+    /** Add the report of the run into @e total. */
+    void accumulate(LoadReport& total)
+    {
+        std::lock_guard <std::mutex> lock(m_mutex);
+
+        total.merge(m_report);
+    }
+
+private:
+    std::map <int, std::unique_ptr <Slot>> m_slots;
+    std::vector <double> m_load;
+    LoadReport m_report;
+    std::mutex m_mutex;
+};
+
+/** Adds the ticks of a scope to @e counter if it is not null. */
+class LoadProbe
+{
+public:
+    explicit LoadProbe(std::atomic <std::uint64_t> *counter)
+        : m_counter(counter)
+        , m_start(counter ? ProfileClock::now() : 0)
+    {}
+
+    LoadProbe(const LoadProbe&) = delete;
+    LoadProbe& operator=(const LoadProbe&) = delete;
+
+    ~LoadProbe()
+    {
+        if (m_counter)
+            m_counter->fetch_add(ProfileClock::now() - m_start,
+                                 std::memory_order_relaxed);
+    }
+
+private:
+    std::atomic <std::uint64_t> *m_counter;
+    std::uint64_t m_start;
+};
+
+/** The load of a logical processor at a time of events. */
+struct StepLoad
+{
+    double time;
+    double load;
+
+    template <typename Archive>
+    void serialize(Archive& ar, const unsigned int)
+    {
+        ar & time & load;
+    }
+};
+
+}
+
+#endif
@@ -26,6 +26,10 @@
 
 #include "linpackc.hpp"
 #include "linpackc.h"
+#include "microbench.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <thread>
 
 namespace bench {
@@ -83,13 +87,62 @@ struct linpackc
     }
 };
 
+/* Written before the simulations start, read by the worker threads. */
+static std::atomic <double> compensation_offset(0.0);
+static std::atomic <double> compensation_slope(1.0);
+static std::atomic <double> compensation_floor(0.0);
+
+void sleep_and_work_compensation(double offset, double slope, double floor)
+{
+    compensation_offset.store(std::max(0.0, offset));
+    compensation_slope.store(slope > 0.0 ? slope : 1.0);
+    compensation_floor.store(std::max(0.0, floor));
+}
+
 void sleep_and_work(double duration)
 {
-    long int d = static_cast <long int>(duration * 1000.0);
+    double offset = compensation_offset.load(std::memory_order_relaxed);
+    double slope = compensation_slope.load(std::memory_order_relaxed);
+    double floor = compensation_floor.load(std::memory_order_relaxed);
+
+    /* A request below the floor is shorter than the dispatch of the
+     * linpack thread: it is spun in the calling thread. Above, the linpack
+     * thread lives for the part of the request that the overshoot model
+     * allows. */
+    if (duration < floor) {
+        spin_and_work(duration);
+        return;
+    }
+
+    double sleep = (duration - offset) / slope;
 
     bench::linpackc lp;
-    std::this_thread::sleep_for(std::chrono::microseconds(d));
+    if (sleep > 0.0)
+        std::this_thread::sleep_for(std::chrono::microseconds(
+                static_cast <long int>(sleep * 1000.0)));
     lp.set_end();
 }
 
+void spin_and_work(double duration)
+{
+    auto deadline = std::chrono::steady_clock::now() +
+        std::chrono::nanoseconds(static_cast <long int>(duration * 1e6));
+    double x = 1.0;
+
+    do {
+        for (int i = 0; i < 64; ++i)
+            x = x * 0.999999 + 1e-6;
+    } while (std::chrono::steady_clock::now() < deadline);
+
+    bench::do_not_optimize(x);
+}
+
+void work(double duration)
+{
+    if (duration < work_threshold)
+        spin_and_work(duration);
+    else
+        sleep_and_work(duration);
+}
+
 }
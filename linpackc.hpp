@@ -38,6 +38,33 @@ namespace bench {
  */
 void sleep_and_work(double duration);
 
+/**
+ * @e spin_and_work computes a floating point loop in the current thread
+ * until @e duration milliseconds have elapsed (no thread start, no sleep).
+ */
+void spin_and_work(double duration);
+
+/**
+ * @e work computes during @e duration milliseconds: with @e spin_and_work
+ * below @e work_threshold, where the start of the linpack thread and the
+ * sleep dominate the cost, with @e sleep_and_work otherwise.
+ */
+const double work_threshold = 1.0;
+
+void work(double duration);
+
+/**
+ * Compensate the overshoot of @e sleep_and_work measured by the
+ * calibration (see calibration.hpp): the actual duration of a sleep of
+ * @e d ms is modeled as max(@e floor, @e offset + @e slope * @e d), so the
+ * linpack thread of a request of @e d ms lives (@e d - @e offset) /
+ * @e slope ms; a request below @e floor is spun in the calling thread
+ * (see @e spin_and_work). Reset with (0, 1, 0). Call
+ * it before starting the simulations: the three values are atomics read
+ * independently by the worker threads.
+ */
+void sleep_and_work_compensation(double offset, double slope, double floor);
+
 }
 
 #endif
@@ -0,0 +1,1326 @@
+/*
+ * Copyright (C) 2014 INRA
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __Benchmark_logical_processor_hpp__
+#define __Benchmark_logical_processor_hpp__
+
+#include "defs.hpp"
+#include "imbalance.hpp"
+#include "profiler.hpp"
+#include "shm-transport.hpp"
+#include "sync-tree.hpp"
+#include "tgf.hpp"
+#include <boost/mpi.hpp>
+#include <boost/serialization/utility.hpp>
+#include <boost/serialization/vector.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <list>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+namespace bench {
+
+/**
+ * @e MpiProtocol is the synchronization of the ranks in MPI mode, read
+ * from `name[,key=value...]' (the -u option):
+ * - synchronous: the Echll's @e SynchronousProxyModel and
+ *   @e SynchronousLogicalProcessor, every rank synchronizes with rank 0 at
+ *   every event time.
+ * - null-message: conservative asynchronous logical processors
+ *   (Chandy-Misra-Bryant).
+ * - window: bulk synchronous logical processors, one reduction and one
+ *   exchange of the events by time window.
+ * - aggregated: the windows with one buffer by destination rank and by
+ *   window, sent with non-blocking point to point messages overlapped
+ *   with the next window.
+ * The key @e lookahead is the minimal delay between an input and an
+ * output of the models other than the top pixels (0 by default), the
+ * key @e serialization the format of the packets of the logical
+ * processors: flat (the default) or archive (see @e LinkCodec) and, with
+ * aggregated, the key @e transport the links between the ranks of a
+ * node: mpi (the default) or shm (see @e ShmTransport, @e ring is the
+ * size of a ring in bytes, 1 MiB by default). With window and
+ * aggregated, the key @e sync is the layout of the reductions of the
+ * windows: collective (the default), flat or tree (see @e SyncTree,
+ * @e fanout is the fan-out of the tree, 4 by default).
+ */
+struct MpiProtocol
+{
+    enum Type { SYNCHRONOUS, NULL_MESSAGE, WINDOW, AGGREGATED };
+
+    Type type = SYNCHRONOUS;
+    double lookahead = 0.0;
+    bool flat = true;
+    bool shm = false;
+    std::size_t ring = 1u << 20;
+    SyncTree::Layout sync = SyncTree::COLLECTIVE;
+    int fanout = 4;
+
+    /** Returns false on error. */
+    bool parse(const std::string& spec)
+    {
+        std::size_t begin = 0;
+        bool first = true;
+
+        while (begin <= spec.size()) {
+            std::size_t end = spec.find(',', begin);
+            if (end == std::string::npos)
+                end = spec.size();
+
+            std::string token = spec.substr(begin, end - begin);
+            begin = end + 1;
+
+            if (first) {
+                first = false;
+
+                if (token == "synchronous")
+                    type = SYNCHRONOUS;
+                else if (token == "null-message")
+                    type = NULL_MESSAGE;
+                else if (token == "window")
+                    type = WINDOW;
+                else if (token == "aggregated")
+                    type = AGGREGATED;
+                else
+                    return false;
+
+                continue;
+            }
+
+            std::size_t equal = token.find('=');
+            if (equal == std::string::npos)
+                return false;
+
+            std::string key = token.substr(0, equal);
+            const char *value = token.c_str() + equal + 1;
+
+            if (key == "serialization") {
+                if (std::strcmp(value, "flat") == 0)
+                    flat = true;
+                else if (std::strcmp(value, "archive") == 0)
+                    flat = false;
+                else
+                    return false;
+
+                continue;
+            }
+
+            if (key == "sync") {
+                if (std::strcmp(value, "collective") == 0)
+                    sync = SyncTree::COLLECTIVE;
+                else if (std::strcmp(value, "flat") == 0)
+                    sync = SyncTree::FLAT;
+                else if (std::strcmp(value, "tree") == 0)
+                    sync = SyncTree::TREE;
+                else
+                    return false;
+
+                continue;
+            }
+
+            if (key == "transport") {
+                if (std::strcmp(value, "mpi") == 0)
+                    shm = false;
+                else if (std::strcmp(value, "shm") == 0)
+                    shm = true;
+                else
+                    return false;
+
+                continue;
+            }
+
+            char *nptr;
+            double number = std::strtod(value, &nptr);
+            if (nptr == value || *nptr != '\0' || number < 0.0)
+                return false;
+
+            if (key == "lookahead")
+                lookahead = number;
+            else if (key == "ring" && number >= 64.0)
+                ring = static_cast <std::size_t>(number);
+            else if (key == "fanout" && number >= 2.0)
+                fanout = static_cast <int>(number);
+            else
+                return false;
+        }
+
+        return (!shm || type == AGGREGATED) &&
+            (sync == SyncTree::COLLECTIVE || type == WINDOW ||
+             type == AGGREGATED);
+    }
+
+    const char* name() const
+    {
+        static const char *names[] = { "synchronous", "null-message",
+                                       "window", "aggregated" };
+
+        return names[type];
+    }
+};
+
+/** The values sent at @e time on the input port @e port of a rank. */
+struct LinkEvent
+{
+    double time;
+    int port;
+    std::vector <Data> values;
+
+    template <typename Archive>
+    void serialize(Archive& ar, const unsigned int)
+    {
+        ar & time & port & values;
+    }
+};
+
+/**
+ * @e LinkPacket is a message between two logical processors: events and
+ * the new claims of the output ports of the sender (the pairs output port,
+ * time). A claim @e t is the promise that the port will not send any
+ * event before @e t. A packet without event is a null message.
+ */
+struct LinkPacket
+{
+    std::vector <std::pair <int, double>> claims;
+    std::vector <LinkEvent> events;
+
+    template <typename Archive>
+    void serialize(Archive& ar, const unsigned int)
+    {
+        ar & claims & events;
+    }
+};
+
+/** Counters of a logical processor, summed over the runs. */
+struct LogicalProcessorStats
+{
+    std::uint64_t events = 0;           /* transitions of the sub-coupled model. */
+    std::uint64_t packets = 0;          /* packets with events. */
+    std::uint64_t null_messages = 0;    /* packets without event. */
+    std::uint64_t messages = 0;         /* values sent. */
+    std::uint64_t claims = 0;           /* claims sent. */
+    std::uint64_t bytes = 0;            /* serialized packets sent. */
+    std::uint64_t windows = 0;          /* reductions of the windows. */
+    std::uint64_t overlapped = 0;       /* events processed during receives. */
+    std::uint64_t shared = 0;           /* packets sent in shared memory. */
+    std::uint64_t serialized = 0;       /* packets written or read. */
+    std::uint64_t serialized_bytes = 0; /* bytes written or read. */
+    double window = 0.0;                /* sum of the widths of the windows. */
+    double blocked = 0.0;               /* milliseconds waiting for MPI. */
+    double serialization = 0.0;         /* milliseconds writing or reading. */
+    double synchronization = 0.0;       /* milliseconds in the reductions. */
+    double processing = 0.0;            /* milliseconds in the events. */
+    double busy = 0.0;                  /* milliseconds in the transitions. */
+
+    /* The load of each time of events of the current run, if recorded (not
+     * serialized). */
+    bool record_steps = false;
+    std::vector <StepLoad> steps;
+
+    template <typename Archive>
+    void serialize(Archive& ar, const unsigned int)
+    {
+        ar & events & packets & null_messages & messages & claims & bytes &
+            windows & overlapped & shared & serialized & serialized_bytes &
+            window & blocked & serialization & synchronization & processing &
+            busy;
+    }
+};
+
+/**
+ * @e LinkCodec writes the packets of the logical processors into byte
+ * buffers and reads them back. If @e Data is trivially copyable (checked
+ * at compile time) and @e flat is true, a packet is a flat buffer: the
+ * number of claims and the claims, the number of events and, for each
+ * event, a header (port, number of values, time) followed by the raw
+ * values. Otherwise the packet goes through a Boost.MPI packed archive.
+ * The time spent and the bytes are counted in the statistics to compare
+ * the two formats.
+ */
+class LinkCodec
+{
+public:
+    typedef boost::mpi::packed_oarchive::buffer_type Buffer;
+
+    static constexpr bool flat_data = std::is_trivially_copyable <Data>::value;
+
+    LinkCodec(bool flat, LogicalProcessorStats& stats)
+        : m_stats(stats)
+        , m_flat(flat && flat_data)
+    {}
+
+    bool flat() const
+    {
+        return m_flat;
+    }
+
+    /** Write @e packet into @e buffer (cleared first), returns its size. */
+    std::size_t write(const LinkPacket& packet, Buffer& buffer)
+    {
+        std::uint64_t start = ProfileClock::now();
+
+        buffer.clear();
+
+        if (m_flat) {
+            write_flat(packet, buffer,
+                       std::integral_constant <bool, flat_data>());
+        } else {
+            boost::mpi::packed_oarchive archive(m_comm, buffer);
+            archive << packet;
+        }
+
+        account(start, buffer.size());
+
+        return buffer.size();
+    }
+
+    /** Read @e packet (cleared first) from @e buffer. */
+    void read(Buffer& buffer, LinkPacket& packet)
+    {
+        std::uint64_t start = ProfileClock::now();
+
+        packet.claims.clear();
+        packet.events.clear();
+
+        if (m_flat) {
+            read_flat(buffer, packet,
+                      std::integral_constant <bool, flat_data>());
+        } else {
+            boost::mpi::packed_iarchive archive(m_comm, buffer);
+            archive >> packet;
+        }
+
+        account(start, buffer.size());
+    }
+
+private:
+    struct EventHeader
+    {
+        std::int32_t port;
+        std::uint32_t count;
+        double time;
+    };
+
+    template <typename T>
+    static void put(Buffer& buffer, const T *values, std::size_t count)
+    {
+        std::size_t size = buffer.size();
+
+        buffer.resize(size + sizeof(T) * count);
+        if (count)
+            std::memcpy(buffer.data() + size, values, sizeof(T) * count);
+    }
+
+    template <typename T>
+    static void get(const Buffer& buffer, std::size_t& position, T *values,
+                    std::size_t count)
+    {
+        if (position + sizeof(T) * count > buffer.size())
+            throw std::runtime_error("link codec: truncated packet");
+
+        if (count)
+            std::memcpy(values, buffer.data() + position, sizeof(T) * count);
+        position += sizeof(T) * count;
+    }
+
+    void write_flat(const LinkPacket& packet, Buffer& buffer, std::true_type)
+    {
+        std::uint32_t claims = static_cast <std::uint32_t>(packet.claims.size());
+        std::uint32_t events = static_cast <std::uint32_t>(packet.events.size());
+        std::size_t size = 2 * sizeof(std::uint32_t) +
+            claims * (sizeof(std::int32_t) + sizeof(double)) +
+            events * sizeof(EventHeader);
+
+        for (const auto& event : packet.events)
+            size += event.values.size() * sizeof(Data);
+
+        buffer.reserve(size);
+        put(buffer, &claims, 1);
+
+        for (const auto& claim : packet.claims) {
+            std::int32_t port = claim.first;
+            put(buffer, &port, 1);
+            put(buffer, &claim.second, 1);
+        }
+
+        put(buffer, &events, 1);
+
+        for (const auto& event : packet.events) {
+            EventHeader header = { event.port,
+                                   static_cast <std::uint32_t>(
+                                       event.values.size()),
+                                   event.time };
+
+            put(buffer, &header, 1);
+            put(buffer, event.values.data(), event.values.size());
+        }
+    }
+
+    void write_flat(const LinkPacket&, Buffer&, std::false_type)
+    {}
+
+    void read_flat(const Buffer& buffer, LinkPacket& packet, std::true_type)
+    {
+        std::size_t position = 0;
+        std::uint32_t count;
+
+        get(buffer, position, &count, 1);
+        packet.claims.resize(count);
+
+        for (auto& claim : packet.claims) {
+            std::int32_t port;
+            get(buffer, position, &port, 1);
+            get(buffer, position, &claim.second, 1);
+            claim.first = port;
+        }
+
+        get(buffer, position, &count, 1);
+        packet.events.resize(count);
+
+        for (auto& event : packet.events) {
+            EventHeader header;
+            get(buffer, position, &header, 1);
+
+            event.time = header.time;
+            event.port = header.port;
+            event.values.resize(header.count);
+            get(buffer, position, event.values.data(), header.count);
+        }
+    }
+
+    void read_flat(const Buffer&, LinkPacket&, std::false_type)
+    {}
+
+    void account(std::uint64_t start, std::size_t bytes)
+    {
+        m_stats.serialization += ProfileClock::milliseconds(
+            ProfileClock::now() - start);
+        m_stats.serialized++;
+        m_stats.serialized_bytes += bytes;
+    }
+
+    boost::mpi::communicator m_comm;
+    LogicalProcessorStats& m_stats;
+    bool m_flat;
+};
+
+/**
+ * @e PartitionLinks is the view of the root TGF file of the logical
+ * processor of the sub-coupled model @e child (rank @e child + 1): the
+ * output ports routed to other ranks, the ports of the other ranks
+ * feeding its input ports and, to compute the claims, the atomic models
+ * of the sub-coupled model in topological order with the input ports and
+ * the atomic models feeding them.
+ */
+struct PartitionLinks
+{
+    struct Feeder
+    {
+        int rank;
+        int port;
+        std::vector <int> inputs;
+    };
+
+    struct Input
+    {
+        int port;
+        std::vector <int> feeders;
+    };
+
+    struct Output
+    {
+        int port;
+        std::vector <int> atomics;          /* atomic models sending on it. */
+        std::vector <int> inputs;           /* input ports connected to it. */
+    };
+
+    struct Destination
+    {
+        int rank;
+        std::vector <int> outputs;
+    };
+
+    struct Route
+    {
+        int destination;
+        int port;
+    };
+
+    std::vector <Feeder> feeders;
+    std::unordered_map <std::uint64_t, int> feeder_index;
+    std::vector <Input> inputs;
+    std::vector <Output> outputs;
+    std::unordered_map <int, std::vector <Route>> routes; /* by output port. */
+    std::vector <Destination> destinations;
+    std::vector <int> order;
+    std::vector <std::vector <int>> predecessors;
+    std::vector <std::vector <int>> atomic_inputs;
+
+    static std::uint64_t key(int rank, int port)
+    {
+        return (static_cast <std::uint64_t>(static_cast <std::uint32_t>(rank))
+                << 32) | static_cast <std::uint32_t>(port);
+    }
+
+    /** Is an output port reached by an input port? */
+    bool dependent() const
+    {
+        std::vector <char> reached(order.size(), 0);
+        bool ret = false;
+
+        for (int atomic : order) {
+            reached[atomic] = !atomic_inputs[atomic].empty();
+
+            for (int predecessor : predecessors[atomic])
+                reached[atomic] |= reached[predecessor];
+        }
+
+        for (const auto& output : outputs) {
+            ret |= !output.inputs.empty();
+
+            for (int atomic : output.atomics)
+                ret |= reached[atomic] != 0;
+        }
+
+        return ret;
+    }
+};
+
+/**
+ * Build the @e PartitionLinks of the sub-coupled model @e child from the
+ * root TGF file @e root and the TGF file of the child @e sub.
+ *
+ * @exception std::invalid_argument if the root has atomic models connected
+ * to the child or if the atomic models of the child have a cycle.
+ */
+inline PartitionLinks partition_links(const TGF& root, const TGF& sub,
+                                      int child)
+{
+    PartitionLinks ret;
+    const int vertex = child + 1;
+    const int size = static_cast <int>(sub.models.size());
+    std::unordered_map <int, int> input_index;
+    std::unordered_map <int, int> output_index;
+    std::map <int, int> destination_index;
+
+    auto input = [&](int port) -> int
+        {
+            auto it = input_index.find(port);
+            if (it != input_index.end())
+                return it->second;
+
+            ret.inputs.push_back(PartitionLinks::Input{port, {}});
+            return input_index[port] = static_cast <int>(ret.inputs.size()) - 1;
+        };
+
+    auto output = [&](int port) -> int
+        {
+            auto it = output_index.find(port);
+            if (it != output_index.end())
+                return it->second;
+
+            ret.outputs.push_back(PartitionLinks::Output{port, {}, {}});
+            return output_index[port] = static_cast <int>(ret.outputs.size()) - 1;
+        };
+
+    for (const auto& edge : root.edges) {
+        if (edge.src == 0 || edge.dst == 0 || edge.src == edge.dst)
+            continue;
+
+        if (edge.src != vertex && edge.dst != vertex)
+            continue;
+
+        int other = edge.src == vertex ? edge.dst : edge.src;
+        if (root.models[other - 1] != "coupled")
+            throw std::invalid_argument("logical processor: the root model "
+                                        "must only have coupled models");
+
+        if (edge.dst == vertex) {
+            auto key = PartitionLinks::key(edge.src, edge.src_port);
+            auto it = ret.feeder_index.find(key);
+            if (it == ret.feeder_index.end()) {
+                ret.feeders.push_back(PartitionLinks::Feeder{edge.src,
+                            edge.src_port, {}});
+                it = ret.feeder_index.emplace(
+                    key, static_cast <int>(ret.feeders.size()) - 1).first;
+            }
+
+            int in = input(edge.dst_port);
+            ret.feeders[it->second].inputs.push_back(in);
+            ret.inputs[in].feeders.push_back(it->second);
+        } else {
+            auto it = destination_index.find(edge.dst);
+            if (it == destination_index.end()) {
+                ret.destinations.push_back(PartitionLinks::Destination{
+                        edge.dst, {}});
+                it = destination_index.emplace(
+                    edge.dst, static_cast <int>(ret.destinations.size()) - 1).first;
+            }
+
+            int out = output(edge.src_port);
+            auto& outputs = ret.destinations[it->second].outputs;
+            if (std::find(outputs.begin(), outputs.end(), out) == outputs.end())
+                outputs.push_back(out);
+
+            ret.routes[edge.src_port].push_back(
+                PartitionLinks::Route{it->second, edge.dst_port});
+        }
+    }
+
+    ret.predecessors.resize(size);
+    ret.atomic_inputs.resize(size);
+    std::vector <std::vector <int>> successors(size);
+
+    for (const auto& edge : sub.edges) {
+        if (edge.src == 0 && edge.dst == 0) {
+            auto out = output_index.find(edge.dst_port);
+            auto in = input_index.find(edge.src_port);
+            if (out != output_index.end() && in != input_index.end())
+                ret.outputs[out->second].inputs.push_back(in->second);
+        } else if (edge.src == 0) {
+            auto in = input_index.find(edge.src_port);
+            if (in != input_index.end())
+                ret.atomic_inputs[edge.dst - 1].push_back(in->second);
+        } else if (edge.dst == 0) {
+            auto out = output_index.find(edge.dst_port);
+            if (out != output_index.end())
+                ret.outputs[out->second].atomics.push_back(edge.src - 1);
+        } else {
+            ret.predecessors[edge.dst - 1].push_back(edge.src - 1);
+            successors[edge.src - 1].push_back(edge.dst - 1);
+        }
+    }
+
+    ret.order = topological_order(static_cast <std::size_t>(size),
+                                  [&successors](int v)
+                                  -> const std::vector <int>&
+                                  {
+                                      return successors[v];
+                                  });
+
+    if (static_cast <int>(ret.order.size()) != size)
+        throw std::invalid_argument("logical processor: cycle between the "
+                                    "atomic models of a sub-coupled model");
+
+    return ret;
+}
+
+/**
+ * @e LogicalProcessor is the state shared by the protocols: a sub-coupled
+ * model driven by its transitions, the events received and not yet
+ * processed and the events to send, by destination.
+ */
+class LogicalProcessor
+{
+public:
+    LogicalProcessor(const vle::Common& common, const PartitionLinks& links,
+                     const MpiProtocol& protocol,
+                     LogicalProcessorStats& stats)
+        : m_common(common)
+        , m_links(links)
+        , m_stats(stats)
+        , m_codec(protocol.flat, stats)
+        , m_outbox(links.destinations.size())
+        , m_tl(0.0)
+        , m_tn(0.0)
+    {}
+
+protected:
+    void init(Model& model, double begin)
+    {
+        m_tl = begin;
+        m_tn = begin + model.init(m_common, begin);
+    }
+
+    /** Time of the next event: a transition or a received event. */
+    double next() const
+    {
+        return std::min(m_tn, pending());
+    }
+
+    double pending() const
+    {
+        return m_pending.empty() ? Infinity <double>::positive :
+            m_pending.begin()->first;
+    }
+
+    /**
+     * Process the transition of the sub-coupled model at @e time: its
+     * outputs if it is imminent and the events received at @e time. The
+     * outputs are appended to the outboxes. If the steps are recorded, the
+     * duration is the load of the step @e time.
+     */
+    void process(Model& model, double time)
+    {
+        std::uint64_t start = m_stats.record_steps ? ProfileClock::now() : 0;
+
+        if (time == m_tn) {
+            model.lambda();
+
+            for (std::size_t port = 0; port != model.y.size(); ++port) {
+                if (model.y[port].empty())
+                    continue;
+
+                auto it = m_links.routes.find(static_cast <int>(port));
+                if (it == m_links.routes.end())
+                    continue;
+
+                for (const auto& route : it->second) {
+                    m_outbox[route.destination].events.push_back(
+                        LinkEvent{time, route.port, model.y[port]});
+                    m_stats.messages += model.y[port].size();
+                }
+            }
+        }
+
+        while (!m_pending.empty() && m_pending.begin()->first == time) {
+            LinkEvent& event = m_pending.begin()->second;
+
+            if (static_cast <std::size_t>(event.port) < model.x.size())
+                model.x[event.port].insert(model.x[event.port].end(),
+                                           event.values.begin(),
+                                           event.values.end());
+
+            m_pending.erase(m_pending.begin());
+        }
+
+        double advance = model.delta(time - m_tl);
+        m_tl = time;
+        m_tn = time + advance;
+        m_stats.events++;
+
+        for (std::size_t port = 0; port != model.x.size(); ++port)
+            model.x[port].clear();
+        for (std::size_t port = 0; port != model.y.size(); ++port)
+            model.y[port].clear();
+
+        if (m_stats.record_steps) {
+            double load = ProfileClock::milliseconds(ProfileClock::now() -
+                                                     start);
+
+            m_stats.processing += load;
+            m_stats.steps.push_back(StepLoad{time, load});
+        }
+    }
+
+    /** Write @e packet into @e buffer for a send. */
+    void pack(const LinkPacket& packet, LinkCodec::Buffer& buffer)
+    {
+        m_stats.bytes += m_codec.write(packet, buffer);
+    }
+
+    /** Store the events of a packet until their time. */
+    void receive(LinkPacket& packet, const char *protocol)
+    {
+        for (auto& event : packet.events) {
+            if (event.time < m_tl)
+                throw std::runtime_error(std::string(protocol) +
+                                         ": causality error, the lookahead "
+                                         "is too large");
+
+            double time = event.time;
+            m_pending.emplace(time, std::move(event));
+        }
+    }
+
+    const vle::Common& m_common;
+    const PartitionLinks& m_links;
+    LogicalProcessorStats& m_stats;
+    LinkCodec m_codec;
+    std::multimap <double, LinkEvent> m_pending;
+    std::vector <LinkPacket> m_outbox;
+    double m_tl;
+    double m_tn;
+};
+
+/**
+ * @e NullMessageLogicalProcessor runs a sub-coupled model on a rank with
+ * the conservative Chandy-Misra-Bryant protocol: the rank processes the
+ * events up to the safe time, the minimum of the claims of its input
+ * ports, without synchronization with the other ranks, and sends with its
+ * events the claims of its output ports. The claim of an output port is
+ * the minimum of the next event of the sub-coupled model and, plus the
+ * lookahead, of the pending events and of the claims of the input ports
+ * that reach the atomic models sending on the port. A top pixel has no
+ * input: its claim is its next transition (the fixed time advance). When
+ * a rank is blocked, the claims that increased are sent in null messages.
+ *
+ * Events received at the time of the last transition are processed by a
+ * new transition at this time (elapsed time 0), as the events of the
+ * next step of a time in the Echll's coupled models, so a zero lookahead
+ * does not block if the atomic graph has no cycle.
+ */
+class NullMessageLogicalProcessor : LogicalProcessor
+{
+public:
+    NullMessageLogicalProcessor(const vle::Common& common,
+                                const PartitionLinks& links,
+                                const MpiProtocol& protocol,
+                                LogicalProcessorStats& stats)
+        : LogicalProcessor(common, links, protocol, stats)
+        , m_lookahead(protocol.lookahead)
+        , m_claims(links.feeders.size(), 0.0)
+        , m_clocks(links.inputs.size(), 0.0)
+        , m_atomics(links.order.size(), 0.0)
+        , m_sent(links.destinations.size())
+        , m_flushed(Infinity <double>::negative)
+    {
+        for (std::size_t i = 0; i != m_sent.size(); ++i)
+            m_sent[i].assign(links.destinations[i].outputs.size(),
+                             -std::numeric_limits <double>::infinity());
+    }
+
+    /** Simulate @e model from @e begin to @e end (excluded). */
+    void run(Model& model, double begin, double end)
+    {
+        std::fill(m_claims.begin(), m_claims.end(), begin);
+        std::fill(m_clocks.begin(), m_clocks.end(), begin);
+        init(model, begin);
+
+        bool done = false;
+
+        for (;;) {
+            double safe = this->safe();
+            double next = this->next();
+
+            if (!done && next < end && next <= safe) {
+                if (next > m_flushed) {
+                    flush(false);
+                    m_flushed = next;
+                }
+
+                process(model, next);
+
+                for (std::size_t i = 0; i != m_outbox.size(); ++i)
+                    if (!m_outbox[i].events.empty())
+                        send(static_cast <int>(i));
+
+                continue;
+            }
+
+            if (!done && next >= end && safe >= end)
+                done = true;
+
+            flush(done);
+
+            if (done && finished())
+                break;
+
+            receive();
+        }
+
+        for (auto& sending : m_sending)
+            sending.request.wait();
+        m_sending.clear();
+    }
+
+private:
+    static const int tag = 4242;
+
+    /** A packet being sent and its buffer, kept until the send completes. */
+    struct Sending
+    {
+        LinkCodec::Buffer buffer;
+        boost::mpi::request request;
+    };
+
+    double safe() const
+    {
+        double ret = Infinity <double>::positive;
+
+        for (double clock : m_clocks)
+            ret = std::min(ret, clock);
+
+        return ret;
+    }
+
+    bool finished() const
+    {
+        for (double claim : m_claims)
+            if (claim != Infinity <double>::positive)
+                return false;
+
+        return true;
+    }
+
+    /** Send the claims that increased (all infinite if @e done). */
+    void flush(bool done)
+    {
+        if (!done)
+            propagate();
+
+        for (std::size_t i = 0; i != m_links.destinations.size(); ++i) {
+            const auto& destination = m_links.destinations[i];
+            auto& packet = m_outbox[i];
+
+            for (std::size_t j = 0; j != destination.outputs.size(); ++j) {
+                double claim = done ? Infinity <double>::positive :
+                    this->claim(m_links.outputs[destination.outputs[j]]);
+
+                if (claim > m_sent[i][j]) {
+                    m_sent[i][j] = claim;
+                    packet.claims.emplace_back(
+                        m_links.outputs[destination.outputs[j]].port, claim);
+                }
+            }
+
+            if (!packet.claims.empty())
+                send(static_cast <int>(i));
+        }
+    }
+
+    /** The claims of the input ports through the atomic models. */
+    void propagate()
+    {
+        for (int atomic : m_links.order) {
+            double clock = Infinity <double>::positive;
+
+            for (int input : m_links.atomic_inputs[atomic])
+                clock = std::min(clock, m_clocks[input]);
+            for (int predecessor : m_links.predecessors[atomic])
+                clock = std::min(clock, m_atomics[predecessor]);
+
+            m_atomics[atomic] = clock;
+        }
+    }
+
+    double claim(const PartitionLinks::Output& output) const
+    {
+        double ret = pending();
+
+        for (int atomic : output.atomics)
+            ret = std::min(ret, m_atomics[atomic]);
+        for (int input : output.inputs)
+            ret = std::min(ret, m_clocks[input]);
+
+        return std::min(m_tn, ret + m_lookahead);
+    }
+
+    void send(int destination)
+    {
+        LinkPacket& packet = m_outbox[destination];
+
+        if (packet.events.empty())
+            m_stats.null_messages++;
+        else
+            m_stats.packets++;
+
+        m_stats.claims += packet.claims.size();
+        m_sending.remove_if([](Sending& sending)
+                            {
+                                return !!sending.request.test();
+                            });
+        m_sending.emplace_back();
+        pack(packet, m_sending.back().buffer);
+        m_sending.back().request = m_comm.isend(
+            m_links.destinations[destination].rank, tag,
+            m_sending.back().buffer);
+
+        packet.claims.clear();
+        packet.events.clear();
+    }
+
+    void receive()
+    {
+        auto start = std::chrono::steady_clock::now();
+        boost::mpi::status status = m_comm.probe(boost::mpi::any_source, tag);
+        m_comm.recv(status.source(), tag, m_buffer);
+        m_stats.blocked += std::chrono::duration <double, std::milli>(
+            std::chrono::steady_clock::now() - start).count();
+
+        m_codec.read(m_buffer, m_packet);
+        LogicalProcessor::receive(m_packet, "null-message");
+
+        for (const auto& claim : m_packet.claims) {
+            auto it = m_links.feeder_index.find(
+                PartitionLinks::key(status.source(), claim.first));
+            if (it == m_links.feeder_index.end())
+                continue;
+
+            m_claims[it->second] = std::max(m_claims[it->second], claim.second);
+
+            for (int input : m_links.feeders[it->second].inputs) {
+                double clock = Infinity <double>::positive;
+
+                for (int feeder : m_links.inputs[input].feeders)
+                    clock = std::min(clock, m_claims[feeder]);
+
+                m_clocks[input] = clock;
+            }
+        }
+    }
+
+    boost::mpi::communicator m_comm;
+    LinkCodec::Buffer m_buffer;
+    LinkPacket m_packet;
+    double m_lookahead;
+    std::vector <double> m_claims;      /* by feeder. */
+    std::vector <double> m_clocks;      /* by input port. */
+    std::vector <double> m_atomics;     /* by atomic model. */
+    std::vector <std::vector <double>> m_sent;
+    std::list <Sending> m_sending;
+    double m_flushed;
+};
+
+/**
+ * @e WindowLogicalProcessor runs a sub-coupled model on a rank with a
+ * conservative bulk synchronous protocol. The worker ranks (@e workers,
+ * rank @e i for the world rank @e i + 1) agree on a window [T, E) with one
+ * reduction: T is the next event of all the ranks and E the first time a
+ * rank may send an event: the next transition of a rank with output ports
+ * or, if an output port depends on an input port, T plus the lookahead.
+ * The window adapts at each reduction: it spans the quiet periods of the
+ * models with few distinct times. Each rank processes its events in the
+ * window (the events at T if E = T) without coordination, then the events
+ * of the window are exchanged in one all to all. The events sent at T are
+ * processed at T in the next window by a transition with an elapsed time
+ * 0, so a zero lookahead progresses if the atomic graph has no cycle. The
+ * reduction follows the @e SyncTree layout of the protocol.
+ */
+class WindowLogicalProcessor : LogicalProcessor
+{
+public:
+    WindowLogicalProcessor(const vle::Common& common,
+                           const PartitionLinks& links,
+                           const MpiProtocol& protocol,
+                           const boost::mpi::communicator& workers,
+                           LogicalProcessorStats& stats)
+        : LogicalProcessor(common, links, protocol, stats)
+        , m_workers(workers)
+        , m_sync(workers, protocol.sync, protocol.fanout)
+        , m_lookahead(protocol.lookahead)
+        , m_dependent(links.dependent())
+    {}
+
+    /** Simulate @e model from @e begin to @e end (excluded). */
+    void run(Model& model, double begin, double end)
+    {
+        init(model, begin);
+
+        std::vector <LinkCodec::Buffer> outgoing(m_workers.size());
+        std::vector <LinkCodec::Buffer> incoming;
+        LinkPacket packet;
+
+        for (;;) {
+            double local[3] = {
+                next(),
+                m_links.outputs.empty() ? Infinity <double>::positive : m_tn,
+                m_dependent ? 0.0 : Infinity <double>::positive
+            };
+            double global[3];
+
+            auto start = std::chrono::steady_clock::now();
+            m_sync.minimum(local, 3, global);
+            double elapsed = std::chrono::duration <double, std::milli>(
+                std::chrono::steady_clock::now() - start).count();
+            m_stats.blocked += elapsed;
+            m_stats.synchronization += elapsed;
+            m_stats.windows++;
+
+            double first = global[0];
+            if (first >= end)
+                break;
+
+            double last = std::min(global[1], first + m_lookahead + global[2]);
+            m_stats.window += std::min(last, end) - first;
+
+            for (;;) {
+                double time = next();
+
+                if (time >= end || (time != first && time >= last))
+                    break;
+
+                process(model, time);
+            }
+
+            for (std::size_t i = 0; i != m_outbox.size(); ++i) {
+                if (m_outbox[i].events.empty())
+                    continue;
+
+                m_stats.packets++;
+                pack(m_outbox[i], outgoing[m_links.destinations[i].rank - 1]);
+                m_outbox[i].events.clear();
+            }
+
+            start = std::chrono::steady_clock::now();
+            boost::mpi::all_to_all(m_workers, outgoing, incoming);
+            m_stats.blocked += std::chrono::duration <double, std::milli>(
+                std::chrono::steady_clock::now() - start).count();
+
+            for (auto& buffer : outgoing)
+                buffer.clear();
+
+            for (auto& buffer : incoming) {
+                if (buffer.empty())
+                    continue;
+
+                m_codec.read(buffer, packet);
+                receive(packet, "window");
+            }
+        }
+    }
+
+private:
+    boost::mpi::communicator m_workers;
+    SyncTree m_sync;
+    double m_lookahead;
+    bool m_dependent;
+};
+
+/**
+ * @e AggregatedLogicalProcessor runs the windows of the
+ * @e WindowLogicalProcessor without the all to all: at the end of a
+ * window, the events for a destination rank are serialized into one
+ * buffer sent with a non-blocking send (an empty packet if there is no
+ * event, so the receiver knows the number of messages of a window) and
+ * the receives of the next packets are posted. The reduction of the next
+ * window includes the first time of the events in flight: the events
+ * before this time are processed before waiting for the receives, so the
+ * local computation overlaps the transfers. With an @e ShmTransport
+ * (@e shm), the packets between the ranks of a node go through its rings
+ * instead of MPI.
+ */
+class AggregatedLogicalProcessor : LogicalProcessor
+{
+public:
+    AggregatedLogicalProcessor(const vle::Common& common,
+                               const PartitionLinks& links,
+                               const MpiProtocol& protocol,
+                               const boost::mpi::communicator& workers,
+                               ShmTransport *shm,
+                               LogicalProcessorStats& stats)
+        : LogicalProcessor(common, links, protocol, stats)
+        , m_workers(workers)
+        , m_sync(workers, protocol.sync, protocol.fanout)
+        , m_shm(shm)
+        , m_buffers(links.destinations.size())
+        , m_lookahead(protocol.lookahead)
+        , m_dependent(links.dependent())
+    {
+        m_sources = sources(links);
+        m_incoming.resize(m_sources.size());
+    }
+
+    /**
+     * The shared memory transport of the links of @e links (collective
+     * over @e workers).
+     */
+    static std::unique_ptr <ShmTransport> transport(
+        const PartitionLinks& links, const boost::mpi::communicator& workers,
+        std::size_t ring)
+    {
+        std::vector <int> destinations;
+
+        for (const auto& destination : links.destinations)
+            destinations.push_back(destination.rank - 1);
+
+        return std::unique_ptr <ShmTransport>(
+            new ShmTransport(workers, sources(links), destinations, ring));
+    }
+
+    /** Simulate @e model from @e begin to @e end (excluded). */
+    void run(Model& model, double begin, double end)
+    {
+        init(model, begin);
+
+        double flight = Infinity <double>::positive;
+        bool posted = false;
+
+        for (;;) {
+            double local[4] = {
+                next(),
+                m_links.outputs.empty() ? Infinity <double>::positive : m_tn,
+                m_dependent ? 0.0 : Infinity <double>::positive,
+                flight
+            };
+            double global[4];
+
+            auto start = std::chrono::steady_clock::now();
+            m_sync.minimum(local, 4, global);
+            double elapsed = std::chrono::duration <double, std::milli>(
+                std::chrono::steady_clock::now() - start).count();
+            m_stats.blocked += elapsed;
+            m_stats.synchronization += elapsed;
+            m_stats.windows++;
+
+            double first = std::min(global[0], global[3]);
+            if (first >= end) {
+                if (posted)
+                    wait_receives(false);
+
+                wait_sends();
+                break;
+            }
+
+            double last = std::min(global[1], first + m_lookahead + global[2]);
+            m_stats.window += std::min(last, end) - first;
+
+            m_stats.overlapped += process(model, first, last, end, global[3]);
+
+            if (posted)
+                wait_receives(true);
+
+            for (std::size_t i = 0; i != m_sources.size(); ++i)
+                if (!m_shm || !m_shm->local_source(m_sources[i]))
+                    m_receives.push_back(m_workers.irecv(m_sources[i], tag,
+                                                         m_incoming[i]));
+            posted = true;
+
+            process(model, first, last, end, Infinity <double>::positive);
+
+            flight = send();
+        }
+    }
+
+private:
+    static const int tag = 4343;
+
+    /** The worker ranks of the feeders. */
+    static std::vector <int> sources(const PartitionLinks& links)
+    {
+        std::vector <int> ret;
+
+        for (const auto& feeder : links.feeders)
+            if (std::find(ret.begin(), ret.end(), feeder.rank - 1) == ret.end())
+                ret.push_back(feeder.rank - 1);
+
+        return ret;
+    }
+
+    /**
+     * Process the events of the window [@e first, @e last) before @e end
+     * and @e limit, returns the number of events processed.
+     */
+    std::uint64_t process(Model& model, double first, double last,
+                          double end, double limit)
+    {
+        std::uint64_t ret = 0;
+
+        for (;;) {
+            double time = next();
+
+            if (time >= end || time >= limit ||
+                (time != first && time >= last))
+                return ret;
+
+            LogicalProcessor::process(model, time);
+            ret++;
+        }
+    }
+
+    /** Send the outboxes, returns the first time of the events sent. */
+    double send()
+    {
+        double ret = Infinity <double>::positive;
+
+        wait_sends();
+
+        for (std::size_t i = 0; i != m_outbox.size(); ++i) {
+            LinkPacket& packet = m_outbox[i];
+
+            if (packet.events.empty())
+                m_stats.null_messages++;
+            else
+                m_stats.packets++;
+
+            for (const auto& event : packet.events)
+                ret = std::min(ret, event.time);
+
+            int rank = m_links.destinations[i].rank - 1;
+
+            pack(packet, m_buffers[i]);
+            packet.events.clear();
+
+            if (m_shm && m_shm->local_destination(rank)) {
+                m_stats.shared++;
+
+                if (m_shm->send(rank, m_buffers[i], m_stats.blocked))
+                    continue;
+            }
+
+            m_sends.push_back(m_workers.isend(rank, tag, m_buffers[i]));
+        }
+
+        return ret;
+    }
+
+    void wait_sends()
+    {
+        auto start = std::chrono::steady_clock::now();
+        boost::mpi::wait_all(m_sends.begin(), m_sends.end());
+        m_stats.blocked += std::chrono::duration <double, std::milli>(
+            std::chrono::steady_clock::now() - start).count();
+        m_sends.clear();
+    }
+
+    /** Wait for the packets of the last window, stored if @e store. */
+    void wait_receives(bool store)
+    {
+        auto start = std::chrono::steady_clock::now();
+        boost::mpi::wait_all(m_receives.begin(), m_receives.end());
+        m_stats.blocked += std::chrono::duration <double, std::milli>(
+            std::chrono::steady_clock::now() - start).count();
+        m_receives.clear();
+
+        for (std::size_t i = 0; m_shm && i != m_sources.size(); ++i)
+            if (m_shm->local_source(m_sources[i]) &&
+                !m_shm->receive(m_sources[i], m_incoming[i], m_stats.blocked))
+                m_workers.recv(m_sources[i], tag, m_incoming[i]);
+
+        if (!store)
+            return;
+
+        for (auto& buffer : m_incoming) {
+            m_codec.read(buffer, m_packet);
+            receive(m_packet, "aggregated");
+        }
+    }
+
+    boost::mpi::communicator m_workers;
+    SyncTree m_sync;
+    ShmTransport *m_shm;
+    std::vector <int> m_sources;        /* worker ranks of the feeders. */
+    std::vector <LinkCodec::Buffer> m_incoming;
+    std::vector <LinkCodec::Buffer> m_buffers;
+    LinkPacket m_packet;
+    std::vector <boost::mpi::request> m_sends;
+    std::vector <boost::mpi::request> m_receives;
+    double m_lookahead;
+    bool m_dependent;
+};
+
+}
+
+#endif
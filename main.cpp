@@ -28,12 +28,32 @@
 #include <vle/common.hpp>
 #include <vle/mpi-synchronous.hpp>
 #include <vle/vle.hpp>
+#include <algorithm>
 #include <chrono>
+#include <cerrno>
+#include <cinttypes>
+#include <cstring>
+#include <map>
 #include "defs.hpp"
 #include "timer.hpp"
+#include "activity.hpp"
+#include "logical-processor.hpp"
+#include "calibration.hpp"
 #include "models.hpp"
+#include "critical-path.hpp"
+#include "imbalance.hpp"
+#include "memory.hpp"
+#include "migration.hpp"
+#include "perf.hpp"
+#include "profiler.hpp"
+#include "repartition.hpp"
+#include "stats.hpp"
+#include "tgf.hpp"
+#include "trace.hpp"
+#include "workload.hpp"
 #include <cstdlib>
 #include <unistd.h>
+#include <sys/stat.h>
 
 static void main_show_version()
 {
@@ -44,13 +64,15 @@ static void main_show_version()
 
 static void main_show_help()
 {
-    std::fprintf(stdout, "Echll_Benchmark [-v][-h][-d duration][-c replicas][-t thread_mode]\n"
+    std::fprintf(stdout, "Echll_Benchmark [-v][-h][-a][-p][-m][-l][-k][-j][-r][-w][-b][-g][-i][-e costs][-f trace][-x params][-y policy][-z dir][-u protocol][-d duration][-c replicas][-t thread_mode]\n"
                  "                [-q verbose_level][-o output_file][-s begin,duration][-n thread_number]\n"
                  "Options:\n"
                  "  -h          This help\n"
                  "  -v          Version of Echll_Benchmark\n"
-                 "  -d integer  Assigning minimal duration to internal transition\n"
-                 "              0 means, no duration\n"
+                 "  -d duration Assigning minimal duration to internal transition\n"
+                 "              in milliseconds or with a unit: 1.5ms, 20us,\n"
+                 "              500ns, 2s. 0 means, no duration. Durations\n"
+                 "              below 1ms are computed in the model's thread\n"
                  "  -c integer  Assigning number of run by simulation\n"
                  "  -t integer  0: no thread\n"
                  "              1: using thread for root\n"
@@ -64,6 +86,192 @@ static void main_show_help()
                  "              the simulation. Default 0,10\n"
                  "  -n thread_number Assign the maximum thread to use. Default\n"
                  "              is the value of std::thread::hardware_concurrency()\n"
+                 "  -a          Record the cost of each transition and compute the\n"
+                 "              critical path of each step (no MPI mode). Adds the\n"
+                 "              lines (mean of the runs):\n"
+                 "              critical-path;steps;work;span;level-span;parallelism;\n"
+                 "                max-width;threads;bound;speedup;measured;efficiency\n"
+                 "              critical-path-step;step;work;span;level-span;\n"
+                 "                parallelism;max-width\n"
+                 "  -p          Collect hardware and software counters with\n"
+                 "              perf_event_open (Linux, no MPI mode). Adds the\n"
+                 "              line (mean per run, -1 if not permitted):\n"
+                 "              perf;cycles;instructions;ipc;llc-misses;\n"
+                 "                branch-misses;context-switches;cpu-migrations\n"
+                 "  -m          Account the allocations of the construction, the\n"
+                 "              simulation and the destruction of the models (no\n"
+                 "              MPI mode). Adds the line (mean per run):\n"
+                 "              memory;models;transitions;construction-allocations;\n"
+                 "                construction-bytes;simulation-allocations;\n"
+                 "                simulation-bytes;teardown-deallocations;\n"
+                 "                bytes-per-model;allocations-per-transition;\n"
+                 "                peak-rss\n"
+                 "  -l          Allocate the atomic models of each sub-coupled\n"
+                 "              model from per type arenas (no MPI mode)\n"
+                 "  -k          Copy the whole parameters map for each atomic\n"
+                 "              model instead of the shared overlay\n"
+                 "  -j          Build the sub-coupled models before the\n"
+                 "              initialization of the root, one after another\n"
+                 "              (no MPI mode). Adds the line (mean per run, in\n"
+                 "              milliseconds):\n"
+                 "              build;total;largest-partition\n"
+                 "  -r          Profile the regions of each run (no MPI mode).\n"
+                 "              Adds, in milliseconds, the lines:\n"
+                 "              profile;run;total;load;build;init;simulate;teardown\n"
+                 "              region;path;threads;count;total (all the runs)\n"
+                 "  -w          Publish live statistics (replicate, simulated\n"
+                 "              time, steps, transitions and messages) in the\n"
+                 "              shared memory segment /echll-benchmark.pid (no\n"
+                 "              MPI mode). Watch it with echll-benchmark-monitor\n"
+                 "              or send SIGUSR1 to write on stderr the line:\n"
+                 "              stats;file;replicate;replicates;time;steps;\n"
+                 "                transitions;messages;elapsed\n"
+                 "  -b          Calibrate sleep_and_work at startup (10 us to\n"
+                 "              100 ms) and compensate its overshoot. Writes\n"
+                 "              (durations in milliseconds, errors relative):\n"
+                 "              calibration;offset;slope;floor;tolerance\n"
+                 "              calibration-size;requested;raw-median;raw-p90;\n"
+                 "                median;p90;error;within-tolerance\n"
+                 "              calibration-residual;low;high;count\n"
+                 "  -e costs    Draw the cost of each atomic model (mean: the\n"
+                 "              duration of -d) from a seeded distribution:\n"
+                 "              name[,key=value...][,per-transition] with the\n"
+                 "              names constant, uniform (spread), exponential,\n"
+                 "              lognormal (sigma), hotspot (ratio, factor) and\n"
+                 "              skewed (skew: mean * (1 + skew * partition)) and\n"
+                 "              the key seed. per-transition draws a new cost\n"
+                 "              at each transition. Adds the lines (mean per\n"
+                 "              run, work in milliseconds, no MPI mode):\n"
+                 "              workload;partition;models;work\n"
+                 "              workload-imbalance;partitions;total;max;mean;\n"
+                 "                imbalance\n"
+                 "  -f trace    Replay the costs of a trace: the k-th transition\n"
+                 "              of a model costs the records of the step k of\n"
+                 "              the model (0 if none). Models not in the trace\n"
+                 "              keep the cost of -d or -e. The trace is a binary\n"
+                 "              trace (mapped, see echll-benchmark-trace) or a\n"
+                 "              CSV file of `partition,id,step,cost' or\n"
+                 "              `Sp-i,step,cost' lines, costs in microseconds.\n"
+                 "              Adds the workload lines of -e\n"
+                 "  -x params   Parameters of the sparse models (the TGF\n"
+                 "              types stochastic, periodic and bursty):\n"
+                 "              key=value[,key=value...] with the keys ratio\n"
+                 "              (stochastic: probability to fire at each\n"
+                 "              multiple of unit, default 0.01), unit (1),\n"
+                 "              periods (periodic: period = unit * one of the\n"
+                 "              first `periods' primes, default 8, max 16),\n"
+                 "              burst-length (10), burst-interval (0.01),\n"
+                 "              burst-gap (bursty: exponential gap between\n"
+                 "              bursts, default 10) and seed\n"
+                 "  -i          Measure the load of each partition at each\n"
+                 "              step: busy (the transitions of the atomic\n"
+                 "              models, workload included), routing (the rest\n"
+                 "              of the lambda and delta of the sub-coupled\n"
+                 "              model) and wait (the end of the step by the\n"
+                 "              other partitions). The imbalance factor of a\n"
+                 "              step is max / mean of the load (busy and\n"
+                 "              routing) and its straggler the partition with\n"
+                 "              the largest load. Adds the lines (mean per\n"
+                 "              run, in milliseconds):\n"
+                 "              partition-load;partition;busy;routing;wait;\n"
+                 "                straggler-steps\n"
+                 "              partition-imbalance;partitions;steps;\n"
+                 "                mean-factor;max-factor;overall-factor;\n"
+                 "                straggler;straggler-share;wait-fraction\n"
+                 "              In MPI mode, with the logical processors only:\n"
+                 "              a step is a time of events, routing includes\n"
+                 "              the serialization and wait is the blocked\n"
+                 "              time\n"
+                 "  -y policy   Migrate atomic models between the sub-coupled\n"
+                 "              models at checkpoints between the runs of -c\n"
+                 "              (no MPI mode): every=K (a checkpoint after\n"
+                 "              every K runs, default 1), threshold=F (migrate\n"
+                 "              if the imbalance factor of the load of the\n"
+                 "              partitions, measured as with -i, is above F,\n"
+                 "              default 1.1) and moves=F (at most the fraction\n"
+                 "              F of the models of a partition moved by\n"
+                 "              checkpoint, default 0.25). The models move with\n"
+                 "              their connections and keep their name, cost and\n"
+                 "              seed: the results do not change. Adds the\n"
+                 "              lines (times in milliseconds):\n"
+                 "              migration;checkpoint;run;imbalance;moved;\n"
+                 "                cut-before;cut-after;plan;write\n"
+                 "              migration-speedup;runs-before;mean-before;\n"
+                 "                runs-after;mean-after;speedup\n"
+                 "  -z dir      Profile-guided repartitioning (no MPI mode):\n"
+                 "              the runs of -c measure the cost of each atomic\n"
+                 "              model and its firings (the messages on each of\n"
+                 "              its output connections), written into\n"
+                 "              dir/profile.csv. The models are repartitioned\n"
+                 "              to balance the measured costs with the least\n"
+                 "              messages between the partitions, the new files\n"
+                 "              are written into dir (root.tgf and S*.tgf) and\n"
+                 "              run -c times again. The models keep their\n"
+                 "              name, cost and seed: the results do not\n"
+                 "              change. Adds the lines (times in milliseconds):\n"
+                 "              repartition;partitions;models;imbalance-before;\n"
+                 "                imbalance-after;cut-before;cut-after;\n"
+                 "                weighted-cut-before;weighted-cut-after;time\n"
+                 "              repartition-makespan;before;after;speedup\n"
+                 "  -u protocol Synchronization of the ranks in MPI mode:\n"
+                 "              synchronous (default, every rank synchronizes\n"
+                 "              with rank 0 at every event time) or\n"
+                 "              null-message[,lookahead=L] (asynchronous\n"
+                 "              logical processors with null messages, L the\n"
+                 "              minimal delay between an input and an output\n"
+                 "              of the models, default 0) or\n"
+                 "              window[,lookahead=L] (logical processors with\n"
+                 "              one reduction and one exchange by adaptive\n"
+                 "              time window) or aggregated[,lookahead=L]\n"
+                 "              (the windows with one non-blocking message by\n"
+                 "              destination rank, overlapped with the next\n"
+                 "              window). The logical processors take the key\n"
+                 "              serialization=flat (default, raw buffers if\n"
+                 "              the data are trivially copyable) or archive\n"
+                 "              (Boost.MPI packed archives). aggregated takes\n"
+                 "              transport=shm (rings in MPI-3 shared memory\n"
+                 "              between the ranks of a node, MPI between the\n"
+                 "              nodes) and ring=bytes (the size of a ring,\n"
+                 "              default 1 MiB). window and aggregated take\n"
+                 "              sync=collective (default, MPI_Allreduce),\n"
+                 "              flat (rank 1 coordinates the others) or tree\n"
+                 "              (a tree of fan-out F, fanout=F, default 4) for\n"
+                 "              the reductions. Writes (mean per run,\n"
+                 "              milliseconds, construction included):\n"
+                 "              mpi;protocol;ranks;partitions;wall\n"
+                 "              and with the logical processors, per rank and\n"
+                 "              in total (blocked: waiting for the others):\n"
+                 "              mpi-rank;rank;events;packets;null-messages;\n"
+                 "                messages;claims;blocked\n"
+                 "              mpi-overhead;events;packets;null-messages;\n"
+                 "                null-ratio;null-per-event\n"
+                 "              mpi-traffic;rank;sends;bytes;bytes-per-send;\n"
+                 "                wait;overlapped-events;shared-sends\n"
+                 "              mpi-serialization;format;packets;bytes;\n"
+                 "                serialization;us-per-packet;mb-per-s\n"
+                 "              and with window and aggregated:\n"
+                 "              mpi-window;windows;windows-per-time-unit;\n"
+                 "                mean-window;sync-us-per-window\n"
+                 "              and with sync=flat or sync=tree, the latency\n"
+                 "              of a reduction by layout and number of ranks:\n"
+                 "              mpi-sync;layout;ranks;fanout;latency-us\n"
+                 "              and with transport=shm, a ping-pong between\n"
+                 "              the ranks 1 and 2 by message size:\n"
+                 "              mpi-transport;transport;bytes;latency-us;\n"
+                 "                mb-per-s\n"
+                 "  -g          Granularity sweep (no MPI mode): run each file\n"
+                 "              with -t 0 and -t 3 for durations from 1us to\n"
+                 "              10ms and write (mean per run, milliseconds):\n"
+                 "              granularity;duration;t0;t3;speedup\n"
+                 "              granularity-break-even;duration (-1 if -t 3\n"
+                 "                never beats -t 0)\n"
+                 "  The result line is followed by (mean per run, rates over\n"
+                 "  the simulation without the construction, no MPI mode):\n"
+                 "              throughput;transitions;external-events;messages;\n"
+                 "                steps;simulation;events-per-s;messages-per-s;\n"
+                 "                ns-per-transition\n"
+                 "  -m, -l or -j adds the line (mean per run, in milliseconds):\n"
+                 "              phases;construction;simulation;teardown\n"
                  "\n"
                  "Examples:\n"
                  "$ Echll_Benchmark -d 100 -c 42 -t 3 root.tgf\n"
@@ -77,6 +285,9 @@ static void main_show_help()
     std::exit(EXIT_SUCCESS);
 }
 
+/** Relative tolerance of the calibration report of sleep_and_work. */
+static const double calibration_tolerance = 0.05;
+
 struct main_parameter
 {
     main_parameter() = default;
@@ -84,11 +295,32 @@ struct main_parameter
     double simulation_begin = 0.0;
     double simulation_duration = 10.0;
     unsigned long int thread_number = std::max(1u, std::thread::hardware_concurrency());
-    long int duration = 100;
+    double duration = 100.0;
     long int counter = 1;
     int verbose_mode = 0;
     bool use_thread_root = false;
     bool use_thread_sub = false;
+    bool analysis = false;
+    bool perf = false;
+    bool memory = false;
+    bool arena = false;
+    bool common_copy = false;
+    bool prebuild = false;
+    bool profile = false;
+    bool stats = false;
+    bool calibrate = false;
+    bool sweep = false;
+    bool imbalance = false;
+    bool migrate = false;
+    bench::MigrationPolicy migration;
+    std::string migration_spec;
+    std::string repartition;
+    std::string costs;
+    std::string trace_file;
+    std::shared_ptr <const bench::Trace> trace;
+    std::string activity_spec;
+    std::shared_ptr <const bench::Activity> activity;
+    bench::MpiProtocol protocol;
     FILE *output = stdout;
 
     void print(const vle::Context& ctx)
@@ -97,12 +329,40 @@ struct main_parameter
                  "Flags:\n"
                  "- simulation begin at: %f\n"
                  "- simulation duration: %f\n"
-                 "- duration: %ld ms\n"
+                 "- duration: %f ms\n"
                  "- counter: %ld runs\n"
                  "- use threaded root: %d\n"
-                 "- use threaded coupled: %d\n",
+                 "- use threaded coupled: %d\n"
+                 "- critical path analysis: %d\n"
+                 "- performance counters: %d\n"
+                 "- allocation accounting: %d\n"
+                 "- arena allocation: %d\n"
+                 "- copy parameters: %d\n"
+                 "- separate build: %d\n"
+                 "- profile: %d\n"
+                 "- live statistics: %d\n"
+                 "- calibration: %d\n"
+                 "- granularity sweep: %d\n"
+                 "- partition load: %d\n"
+                 "- migration: %s\n"
+                 "- repartition: %s\n"
+                 "- costs: %s\n"
+                 "- trace: %s\n"
+                 "- activity: %s\n"
+                 "- MPI protocol: %s (lookahead %f, %s serialization, %s "
+                 "transport, %s synchronization)\n",
                  simulation_begin, simulation_duration,
-                 duration, counter, use_thread_root, use_thread_sub);
+                 duration, counter, use_thread_root, use_thread_sub,
+                 analysis, perf, memory, arena, common_copy, prebuild,
+                 profile, stats, calibrate, sweep, imbalance,
+                 migrate ? migration_spec.c_str() : "none",
+                 repartition.empty() ? "none" : repartition.c_str(),
+                 costs.empty() ? "-d" : costs.c_str(),
+                 trace_file.c_str(), activity_spec.c_str(),
+                 protocol.name(), protocol.lookahead,
+                 protocol.flat ? "flat" : "archive",
+                 protocol.shm ? "shm" : "mpi",
+                 bench::SyncTree::name(protocol.sync));
     }
 
     ~main_parameter()
@@ -112,13 +372,39 @@ struct main_parameter
     }
 };
 
+/**
+ * Read a duration in milliseconds: a number followed by an optional unit
+ * (ns, us, ms or s, default ms).
+ */
+static bool main_parse_duration(const char *str, double *duration)
+{
+    char *nptr;
+    double value = std::strtod(str, &nptr);
+
+    if (nptr == str)
+        return false;
+
+    if (*nptr == '\0' || std::strcmp(nptr, "ms") == 0)
+        *duration = value;
+    else if (std::strcmp(nptr, "us") == 0)
+        *duration = value / 1e3;
+    else if (std::strcmp(nptr, "ns") == 0)
+        *duration = value / 1e6;
+    else if (std::strcmp(nptr, "s") == 0)
+        *duration = value * 1e3;
+    else
+        return false;
+
+    return true;
+}
+
 static main_parameter main_getopt(const vle::Context& ctx,
                                   int argc, char* argv[])
 {
     main_parameter ret;
     int opt;
 
-    while ((opt = ::getopt(argc, argv, "vhq:d:c:t:o:s:n:")) != -1) {
+    while ((opt = ::getopt(argc, argv, "vhapmlkjrwbgie:f:x:y:z:u:q:d:c:t:o:s:n:")) != -1) {
         switch (opt) {
         case 'v':
             main_show_version();
@@ -126,6 +412,95 @@ static main_parameter main_getopt(const vle::Context& ctx,
         case 'h':
             main_show_help();
             break;
+        case 'a':
+            ret.analysis = true;
+            break;
+        case 'p':
+            ret.perf = true;
+            break;
+        case 'm':
+            ret.memory = true;
+            break;
+        case 'l':
+            ret.arena = true;
+            break;
+        case 'k':
+            ret.common_copy = true;
+            break;
+        case 'j':
+            ret.prebuild = true;
+            break;
+        case 'r':
+            ret.profile = true;
+            break;
+        case 'w':
+            ret.stats = true;
+            break;
+        case 'b':
+            ret.calibrate = true;
+            break;
+        case 'g':
+            ret.sweep = true;
+            break;
+        case 'i':
+            ret.imbalance = true;
+            break;
+        case 'e':
+            {
+                bench::CostDistribution distribution;
+                if (!distribution.parse(::optarg)) {
+                    std::fprintf(stderr, "-e: Failed to read the cost"
+                                 " distribution %s\n", ::optarg);
+                    exit(EXIT_FAILURE);
+                }
+
+                ret.costs = ::optarg;
+                break;
+            }
+        case 'x':
+            {
+                auto activity = std::make_shared <bench::Activity>();
+                if (!activity->parse(::optarg)) {
+                    std::fprintf(stderr, "-x: Failed to read the activity"
+                                 " parameters %s\n", ::optarg);
+                    exit(EXIT_FAILURE);
+                }
+
+                ret.activity = activity;
+                ret.activity_spec = ::optarg;
+                break;
+            }
+        case 'y':
+            if (!ret.migration.parse(::optarg)) {
+                std::fprintf(stderr, "-y: Failed to read the migration"
+                             " policy %s\n", ::optarg);
+                exit(EXIT_FAILURE);
+            }
+
+            ret.migrate = true;
+            ret.migration_spec = ::optarg;
+            break;
+        case 'z':
+            ret.repartition = ::optarg;
+            if (ret.repartition.back() != '/')
+                ret.repartition += '/';
+            break;
+        case 'u':
+            if (!ret.protocol.parse(::optarg)) {
+                std::fprintf(stderr, "-u: Failed to read the MPI protocol"
+                             " %s\n", ::optarg);
+                exit(EXIT_FAILURE);
+            }
+            break;
+        case 'f':
+            try {
+                ret.trace = std::make_shared <const bench::Trace>(::optarg);
+                ret.trace_file = ::optarg;
+            } catch (const std::exception& e) {
+                std::fprintf(stderr, "-f: %s\n", e.what());
+                exit(EXIT_FAILURE);
+            }
+            break;
         case 'q':
             {
                 char *nptr;
@@ -147,12 +522,10 @@ static main_parameter main_getopt(const vle::Context& ctx,
             break;
         case 'd':
             {
-                char *nptr;
-                ret.duration = ::strtol(::optarg, &nptr, 10);
-                if (nptr == ::optarg) {
+                if (!main_parse_duration(::optarg, &ret.duration)) {
                     std::fprintf(stderr,
-                                 "-d: Failed to convert %s into millisecond"
-                                 " (integer)\n", ::optarg);
+                                 "-d: Failed to convert %s into a duration"
+                                 " (number with ns, us, ms or s)\n", ::optarg);
                     exit(EXIT_FAILURE);
                 }
 
@@ -271,12 +644,31 @@ static main_parameter main_getopt(const vle::Context& ctx,
     return std::move(ret);
 }
 
-static vle::CommonPtr main_common_new(long int duration,
+static vle::CommonPtr main_common_new(const main_parameter& mp,
                                       std::shared_ptr <bench::Factory> factory)
 {
     std::shared_ptr <vle::Common> ret = std::make_shared <vle::Common>();
 
-    ret->emplace("duration", duration);
+    ret->emplace("duration", mp.duration);
+
+    if (!mp.costs.empty()) {
+        auto distribution = std::make_shared <bench::CostDistribution>();
+        distribution->parse(mp.costs);
+        distribution->mean = mp.duration;
+        ret->emplace("cost-distribution",
+                     std::shared_ptr <const bench::CostDistribution>(
+                         distribution));
+    }
+
+    if (mp.trace)
+        ret->emplace("trace", mp.trace);
+
+    if (mp.activity)
+        ret->emplace("activity", mp.activity);
+
+    ret->emplace("model-arena", mp.arena);
+    ret->emplace("common-copy", mp.common_copy);
+    ret->emplace("prebuild", mp.prebuild);
     ret->emplace("name", std::string("name"));
     ret->emplace("tgf-factory", factory);
     ret->emplace("tgf-source", (int)0);
@@ -298,12 +690,37 @@ main_factory_new(const vle::Context& ctx,
     ret->functions.emplace("normal",
                            [&ctx]() -> modelptr
                            {
-                               return modelptr(new bench::NormalPixel(ctx));
+                               bench::ProfileRegion region("build");
+                               return modelptr(
+                                   bench::arena_new <bench::NormalPixel>(ctx));
                            });
     ret->functions.emplace("top",
                            [&ctx]() -> modelptr
                            {
-                               return modelptr(new bench::TopPixel(ctx));
+                               bench::ProfileRegion region("build");
+                               return modelptr(
+                                   bench::arena_new <bench::TopPixel>(ctx));
+                           });
+    ret->functions.emplace("stochastic",
+                           [&ctx]() -> modelptr
+                           {
+                               bench::ProfileRegion region("build");
+                               return modelptr(
+                                   bench::arena_new <bench::StochasticPixel>(ctx));
+                           });
+    ret->functions.emplace("periodic",
+                           [&ctx]() -> modelptr
+                           {
+                               bench::ProfileRegion region("build");
+                               return modelptr(
+                                   bench::arena_new <bench::PeriodicPixel>(ctx));
+                           });
+    ret->functions.emplace("bursty",
+                           [&ctx]() -> modelptr
+                           {
+                               bench::ProfileRegion region("build");
+                               return modelptr(
+                                   bench::arena_new <bench::BurstyPixel>(ctx));
                            });
 
     if (mpi_mode_and_root) {
@@ -373,6 +790,525 @@ struct Sample
     std::vector <double> sample;
 };
 
+/**
+ * @e RunSample accumulates, run after run, the duration and the allocations
+ * of the three phases of a run: construction (until the first transition),
+ * simulation and teardown (the destructors of the models). Without
+ * @e MemoryProbe (no -m), the construction ends with the initialization of
+ * the Root (@e time_simulation_start) and the allocations are not counted.
+ */
+struct RunSample
+{
+    typedef std::chrono::steady_clock::time_point time_point;
+
+    void add(const bench::MemoryProbe *probe,
+             const bench::AllocationStats& begin,
+             const bench::AllocationStats& end_of_simulation,
+             const bench::AllocationStats& end,
+             time_point time_begin,
+             time_point time_simulation_start,
+             time_point time_end_of_simulation,
+             time_point time_end)
+    {
+        bench::AllocationStats simulation_start = end_of_simulation;
+
+        if (probe && probe->started()) {
+            simulation_start = probe->simulation_start;
+            time_simulation_start = probe->simulation_start_time;
+        }
+
+        bench::AllocationStats construction = simulation_start - begin;
+        bench::AllocationStats simulation = end_of_simulation - simulation_start;
+        bench::AllocationStats teardown = end - end_of_simulation;
+
+        if (probe) {
+            models += probe->models.load();
+            transitions += probe->transitions.load();
+        }
+
+        construction_allocations += construction.allocations;
+        construction_bytes += construction.bytes;
+        construction_live_bytes += construction.live_bytes();
+        simulation_allocations += simulation.allocations;
+        simulation_bytes += simulation.bytes;
+        teardown_deallocations += teardown.deallocations;
+        peak_rss += bench::memory_peak_rss();
+
+        construction_time += milliseconds(time_simulation_start - time_begin);
+        simulation_time += milliseconds(time_end_of_simulation -
+                                        time_simulation_start);
+        teardown_time += milliseconds(time_end - time_end_of_simulation);
+        runs++;
+    }
+
+    void print_memory(FILE *output) const
+    {
+        double n = runs ? static_cast <double>(runs) : 1.0;
+
+        std::fprintf(output, "memory;%.0f;%.0f;%.0f;%.0f;%.0f;%.0f;%.0f;%f;%f;"
+                     "%.0f\n",
+                     models / n, transitions / n,
+                     construction_allocations / n, construction_bytes / n,
+                     simulation_allocations / n, simulation_bytes / n,
+                     teardown_deallocations / n,
+                     models ? construction_live_bytes / models : 0.0,
+                     transitions ? simulation_allocations / transitions : 0.0,
+                     peak_rss / n);
+    }
+
+    void print_phases(FILE *output) const
+    {
+        double n = runs ? static_cast <double>(runs) : 1.0;
+
+        std::fprintf(output, "phases;%f;%f;%f\n", construction_time / n,
+                     simulation_time / n, teardown_time / n);
+    }
+
+    static double milliseconds(std::chrono::steady_clock::duration d)
+    {
+        return std::chrono::duration <double, std::milli>(d).count();
+    }
+
+    double models = 0.0;
+    double transitions = 0.0;
+    double construction_allocations = 0.0;
+    double construction_bytes = 0.0;
+    double construction_live_bytes = 0.0;
+    double simulation_allocations = 0.0;
+    double simulation_bytes = 0.0;
+    double teardown_deallocations = 0.0;
+    double peak_rss = 0.0;
+    double construction_time = 0.0;
+    double simulation_time = 0.0;
+    double teardown_time = 0.0;
+    long int runs = 0;
+};
+
+struct Replicate
+{
+    double duration = -1.0;
+    bench::AllocationStats memory_simulation;
+    RunSample::time_point time_simulation_start;
+    RunSample::time_point time_simulation;
+    double build_time = 0.0;
+    double largest_build_time = 0.0;
+    double simulation_time = 0.0;
+    std::uint64_t transitions = 0;
+    std::uint64_t externals = 0;
+    std::uint64_t messages = 0;
+    std::uint64_t steps = 0;
+};
+
+/**
+ * @e Throughput sums the events of the replicates. The rates are computed
+ * over the simulation, i.e. `sim.run' without the construction of the
+ * model tree (the Root's initialization).
+ */
+struct Throughput
+{
+    double simulation_time = 0.0;
+    std::uint64_t transitions = 0;
+    std::uint64_t externals = 0;
+    std::uint64_t messages = 0;
+    std::uint64_t steps = 0;
+
+    void add(const Replicate& replicate)
+    {
+        simulation_time += replicate.simulation_time;
+        transitions += replicate.transitions;
+        externals += replicate.externals;
+        messages += replicate.messages;
+        steps += replicate.steps;
+    }
+
+    void print(FILE *output, long int counter) const
+    {
+        double n = static_cast <double>(counter);
+        double seconds = simulation_time / 1000.0;
+
+        std::fprintf(output, "throughput;%f;%f;%f;%f;%f;%f;%f;%f\n",
+                     static_cast <double>(transitions) / n,
+                     static_cast <double>(externals) / n,
+                     static_cast <double>(messages) / n,
+                     static_cast <double>(steps) / n,
+                     simulation_time / n,
+                     seconds > 0.0 ? static_cast <double>(transitions) / seconds : 0.0,
+                     seconds > 0.0 ? static_cast <double>(messages) / seconds : 0.0,
+                     transitions ? simulation_time * 1e6 /
+                     static_cast <double>(transitions) : 0.0);
+    }
+};
+
+/**
+ * Build, simulate and destroy the model @e RootT once. The regions of the
+ * profiler are: `replicate' (the measured time of the run), `setup' (the
+ * root and the simulation objects), `run' (sim.run) which contains `init'
+ * (the construction of the model tree) and `teardown' (destructors).
+ */
+template <typename RootT>
+static void main_replicate(const vle::Context& ctx,
+                           const main_parameter& mp,
+                           bench::DSDE& dsde_engine,
+                           bench::PerfCounters *perf,
+                           bench::MemoryProbe *memory,
+                           bench::StatsSegment& stats,
+                           Replicate& out)
+{
+    bench::ProfileRegion replicate("replicate", &out.duration);
+    bench::PerfScope perf_scope(perf);
+    bench::ProfileRegion teardown;
+    bench::ProfileRegion setup("setup");
+    RootT root(ctx, mp.thread_number);
+    vle::Simulation <bench::DSDE> sim(ctx, dsde_engine, root);
+    setup.stop();
+
+    std::uint64_t transitions = stats.transitions();
+    std::uint64_t externals = stats.externals();
+    std::uint64_t messages = stats.messages();
+    double run_time = 0.0;
+    RunSample::time_point run_begin = std::chrono::steady_clock::now();
+
+    {
+        bench::ProfileRegion region("run", &run_time);
+        sim.run(mp.simulation_begin,
+                mp.simulation_duration + mp.simulation_begin);
+    }
+
+    out.simulation_time = std::max(0.0, run_time - root.m_init_time);
+    out.transitions = stats.transitions() - transitions;
+    out.externals = stats.externals() - externals;
+    out.messages = stats.messages() - messages;
+    out.steps = stats.steps.load();
+
+    if (memory)
+        out.memory_simulation = bench::allocation_snapshot();
+
+    out.time_simulation = std::chrono::steady_clock::now();
+    out.time_simulation_start = run_begin +
+        std::chrono::duration_cast <std::chrono::steady_clock::duration>(
+            std::chrono::duration <double, std::milli>(root.m_init_time));
+
+    out.build_time = root.m_build_time;
+    out.largest_build_time = root.m_largest_build_time;
+
+    teardown.start("teardown");
+}
+
+/**
+ * Print the breakdown of the replicate @e run from the region totals
+ * before and after the replicate:
+ * - load: the reading of the TGF files and the connection of the models,
+ *   i.e. `setup' and `init' without `build' and `model-init'.
+ * - build: the creation of the atomic models by the factory.
+ * - init: the initialization of the atomic models.
+ * - simulate: `run' without `init'.
+ * - teardown: the destructors of the models.
+ */
+static void main_profile_print(
+    FILE *output, long int run,
+    const std::map <std::string, bench::Profiler::Stat>& before,
+    const std::map <std::string, bench::Profiler::Stat>& after)
+{
+    auto get = [&before, &after](const char *name) -> double
+        {
+            auto a = after.find(name);
+            if (a == after.end())
+                return 0.0;
+
+            std::uint64_t ticks = a->second.ticks;
+            auto b = before.find(name);
+            if (b != before.end())
+                ticks -= b->second.ticks;
+
+            return bench::ProfileClock::milliseconds(ticks);
+        };
+
+    double replicate = get("replicate");
+    double build = get("build");
+    double init = get("model-init");
+    double load = std::max(0.0, get("setup") + get("init") - build - init);
+    double simulate = get("run") - get("init");
+
+    std::fprintf(output, "profile;%ld;%f;%f;%f;%f;%f;%f\n", run, replicate,
+                 load, build, init, simulate, get("teardown"));
+}
+
+/**
+ * A checkpoint of the migration after the run @e run: if the imbalance
+ * factor of the load of the partitions since the last checkpoint
+ * (@e report) is above the threshold, models are moved and the new files
+ * are written into @e directory for the next runs. Writes the line
+ * `migration' and returns the number of moved models.
+ */
+static std::size_t main_migrate(const main_parameter& mp,
+                                bench::Migration& migration, long int run,
+                                const bench::LoadReport& report,
+                                const std::string& directory,
+                                vle::Common& common)
+{
+    const bench::Topology& topology = migration.topology();
+    std::vector <double> load(topology.partitions(), 0.0);
+    std::size_t cut = migration.cut();
+    std::size_t moved;
+    double plan = 0.0, write = 0.0;
+
+    for (std::size_t p = 0; p != load.size(); ++p) {
+        std::size_t child = static_cast <std::size_t>(topology.children[p]);
+
+        if (child < report.partitions.size())
+            load[p] = report.partitions[child].busy +
+                report.partitions[child].routing;
+    }
+
+    {
+        bench::Timer timer(&plan);
+        moved = migration.plan(load, mp.migration);
+    }
+
+    if (moved) {
+        bench::Timer timer(&write);
+
+        common["model-origin"] = migration.write(directory);
+        common["tgf-filesource"] = directory + "root.tgf";
+        common["tgf-directory"] = directory;
+    }
+
+    std::fprintf(mp.output, "migration;%ld;%ld;%f;%zu;%zu;%zu;%f;%f\n",
+                 (run + 1) / mp.migration.every, run,
+                 bench::Migration::imbalance(load), moved, cut,
+                 migration.cut(), plan, write);
+
+    return moved;
+}
+
+/** Remove the files of @e migration and the directory @e directory. */
+static void main_migration_remove(const bench::Migration& migration,
+                                  const std::string& directory)
+{
+    migration.remove(directory);
+    ::rmdir(directory.c_str());
+}
+
+/**
+ * Write the mean time of the runs before the first migration (all the
+ * runs without migration) and after the last one (the run @e first and
+ * @e last are before their migration).
+ */
+static void main_migration_print(const main_parameter& mp,
+                                 const Sample& sample, long int first,
+                                 long int last)
+{
+    long int before = first < 0 ? mp.counter : first + 1;
+    long int after = first < 0 ? 0 : mp.counter - last - 1;
+    double mean_before = 0.0, mean_after = 0.0;
+
+    for (long int run = 0; run < before; ++run)
+        mean_before += sample.sample[run];
+    for (long int run = mp.counter - after; run < mp.counter; ++run)
+        mean_after += sample.sample[run];
+
+    mean_before = before ? mean_before / static_cast <double>(before) : 0.0;
+    mean_after = after ? mean_after / static_cast <double>(after) : 0.0;
+
+    std::fprintf(mp.output, "migration-speedup;%ld;%f;%ld;%f;%f\n", before,
+                 mean_before, after, mean_after,
+                 mean_after > 0.0 ? mean_before / mean_after : 0.0);
+}
+
+/**
+ * Mean time of @e mp.counter runs of the file @e filename with the current
+ * duration and thread mode of @e mp. The files written by @e
+ * bench::Migration give their @e directory and @e origin.
+ */
+static double main_sweep_run(const vle::Context& ctx, main_parameter& mp,
+                             const char *filename,
+                             const std::string& directory = std::string(),
+                             std::shared_ptr <const bench::ModelOrigin>
+                             origin = nullptr)
+{
+    std::shared_ptr <bench::Factory> factory = main_factory_new(ctx, mp, false);
+    vle::CommonPtr common = main_common_new(mp, factory);
+    auto stats = std::make_shared <bench::StatsSegment>();
+    double total = 0.0;
+
+    common->emplace("stats-segment", stats);
+    common->at("tgf-filesource") = std::string(filename);
+
+    if (origin) {
+        common->emplace("model-origin", origin);
+        common->emplace("tgf-directory", directory);
+    }
+
+    for (long int run = 0; run < mp.counter; ++run) {
+        bench::DSDE dsde_engine(common);
+        Replicate replicate;
+
+        if (mp.use_thread_root)
+            main_replicate <bench::RootThread>(ctx, mp, dsde_engine, nullptr,
+                                               nullptr, *stats, replicate);
+        else
+            main_replicate <bench::RootMono>(ctx, mp, dsde_engine, nullptr,
+                                             nullptr, *stats, replicate);
+
+        if (replicate.duration < 0.0)
+            return -1.0;
+
+        total += replicate.duration;
+    }
+
+    return total / static_cast <double>(mp.counter);
+}
+
+/**
+ * The second pass of the profile-guided repartitioning of @e filename:
+ * repartition its models with the costs of @e profile measured by the
+ * runs of the first pass (mean time @e before), write the new files and
+ * the profile into @e mp.repartition and run them @e mp.counter times.
+ * Writes the lines `repartition' and `repartition-makespan'.
+ */
+static int main_repartition(const vle::Context& ctx, main_parameter& mp,
+                            const char *filename,
+                            const bench::ModelProfile& profile, double before)
+{
+    bool created = ::mkdir(mp.repartition.c_str(), 0755) == 0;
+    if (!created && errno != EEXIST) {
+        vle_info(ctx, "Failed to create the directory %s\n",
+                 mp.repartition.c_str());
+        return -EIO;
+    }
+
+    std::unique_ptr <bench::Migration> migration_ptr;
+    std::vector <int> assignment;
+    std::vector <double> load_before;
+    std::size_t cut_before = 0;
+    double weighted_cut_before = 0.0;
+    double time = 0.0;
+
+    try {
+        migration_ptr.reset(new bench::Migration(filename));
+
+        load_before = bench::partition_weights(migration_ptr->topology(),
+                                               migration_ptr->assignment(),
+                                               profile.cost);
+        cut_before = migration_ptr->cut();
+        weighted_cut_before = bench::weighted_cut(migration_ptr->topology(),
+                                                  migration_ptr->assignment(),
+                                                  profile.firings);
+
+        {
+            bench::Timer timer(&time);
+            assignment = bench::repartition(migration_ptr->topology(),
+                                            profile);
+        }
+
+        migration_ptr->assign(assignment);
+    } catch (const std::exception& e) {
+        vle_info(ctx, "%s\n", e.what());
+        if (created)
+            ::rmdir(mp.repartition.c_str());
+        vle_info(ctx, "Simulation failure\n");
+        return -ECANCELED;
+    }
+
+    bench::Migration& migration = *migration_ptr;
+    const bench::Topology& topology = migration.topology();
+    std::size_t models = 0;
+
+    for (const auto& vertex : topology.vertices)
+        if (vertex.partition >= 0)
+            models++;
+
+    std::shared_ptr <const bench::ModelOrigin> origin;
+    try {
+        profile.write(topology, mp.repartition + "profile.csv");
+        origin = migration.write(mp.repartition);
+    } catch (const std::exception& e) {
+        vle_info(ctx, "%s\n", e.what());
+        return -EIO;
+    }
+
+    std::fprintf(mp.output, "repartition;%zu;%zu;%f;%f;%zu;%zu;%f;%f;%f\n",
+                 topology.partitions(), models,
+                 bench::Migration::imbalance(load_before),
+                 bench::Migration::imbalance(bench::partition_weights(
+                         topology, assignment, profile.cost)),
+                 cut_before, migration.cut(), weighted_cut_before,
+                 bench::weighted_cut(topology, assignment, profile.firings),
+                 time);
+
+    double after = main_sweep_run(ctx, mp,
+                                  (mp.repartition + "root.tgf").c_str(),
+                                  mp.repartition, origin);
+    if (after < 0.0) {
+        vle_info(ctx, "Simulation failure\n");
+        return -ECANCELED;
+    }
+
+    std::fprintf(mp.output, "repartition-makespan;%f;%f;%f\n", before, after,
+                 after > 0.0 ? before / after : 0.0);
+
+    return 0;
+}
+
+/**
+ * Run each file with -t 0 and -t 3 for durations of transition from 1 us
+ * to 10 ms and report the break-even duration where -t 3 becomes faster
+ * than -t 0 (interpolated on a log scale).
+ */
+static int main_sweep(const vle::Context& ctx, main_parameter& mp,
+                      int argc, char *argv[])
+{
+    static const double grains[] = { 0.001, 0.003, 0.01, 0.03, 0.1, 0.3,
+                                     1.0, 3.0, 10.0 };
+
+    for (int i = ::optind; i < argc; ++i) {
+        vle_info(ctx, "Granularity sweep for %s\n", argv[i]);
+
+        double break_even = -1.0;
+        double previous_grain = 0.0;
+        double previous_ratio = 0.0;
+
+        for (double grain : grains) {
+            mp.duration = grain;
+
+            mp.use_thread_root = mp.use_thread_sub = false;
+            double mono = main_sweep_run(ctx, mp, argv[i]);
+
+            mp.use_thread_root = mp.use_thread_sub = true;
+            double thread = main_sweep_run(ctx, mp, argv[i]);
+
+            if (mono < 0.0 || thread < 0.0) {
+                vle_info(ctx, "Simulation failure\n");
+                return -ECANCELED;
+            }
+
+            double ratio = thread / mono;
+
+            std::fprintf(mp.output, "granularity;%f;%f;%f;%f\n", grain,
+                         mono, thread, mono / thread);
+
+            if (break_even < 0.0 && ratio < 1.0) {
+                if (previous_grain == 0.0) {
+                    break_even = grain;
+                } else {
+                    double t = std::log(previous_ratio) /
+                        (std::log(previous_ratio) - std::log(ratio));
+                    break_even = std::exp(std::log(previous_grain) + t *
+                                          (std::log(grain) -
+                                           std::log(previous_grain)));
+                }
+            }
+
+            previous_grain = grain;
+            previous_ratio = ratio;
+        }
+
+        std::fprintf(mp.output, "granularity-break-even;%f\n", break_even);
+    }
+
+    return 0;
+}
+
 static int main_mono_mode(const vle::Context& ctx, int argc, char *argv[])
 {
     main_parameter mp = main_getopt(ctx, argc, argv);
@@ -380,8 +1316,69 @@ static int main_mono_mode(const vle::Context& ctx, int argc, char *argv[])
     vle_info(ctx, "No MPI mode activated\n");
     mp.print(ctx);
 
+    if (mp.calibrate)
+        bench::sleep_and_work_calibrate(mp.output, calibration_tolerance);
+
+    if (mp.sweep)
+        return main_sweep(ctx, mp, argc, argv);
+
+    bench::Profiler::instance().enable(mp.profile);
+
     std::shared_ptr <bench::Factory> factory = main_factory_new(ctx, mp, false);
-    vle::CommonPtr common = main_common_new(mp.duration, factory);
+    vle::CommonPtr common = main_common_new(mp, factory);
+
+    std::shared_ptr <bench::CostRecorder> recorder;
+    if (mp.analysis || !mp.repartition.empty()) {
+        recorder = std::make_shared <bench::CostRecorder>();
+        common->emplace("cost-recorder", recorder);
+    }
+
+    /* The probe counts each transition: only for -m. -l and -j only
+     * time the phases of the runs. */
+    std::shared_ptr <bench::MemoryProbe> memory;
+    if (mp.memory) {
+        memory = std::make_shared <bench::MemoryProbe>();
+        common->emplace("memory-probe", memory);
+        bench::allocation_tracking(true);
+    }
+
+    const bool phases = mp.memory || mp.arena || mp.prebuild;
+
+    std::shared_ptr <bench::WorkloadStats> workload;
+    if (!mp.costs.empty() || mp.trace) {
+        workload = std::make_shared <bench::WorkloadStats>();
+        common->emplace("workload", workload);
+    }
+
+    std::shared_ptr <bench::LoadStats> load;
+    if (mp.imbalance || mp.migrate) {
+        load = std::make_shared <bench::LoadStats>();
+        common->emplace("partition-load", load);
+    }
+
+    std::unique_ptr <bench::PerfCounters> perf;
+    if (mp.perf) {
+        perf.reset(new bench::PerfCounters());
+        if (!perf->available())
+            vle_info(ctx, "Performance counters are not available, check"
+                     " /proc/sys/kernel/perf_event_paranoid\n");
+    }
+
+    std::shared_ptr <bench::StatsSegment> stats;
+    if (mp.stats) {
+        std::string name = bench::stats_name(::getpid());
+        stats = bench::stats_publish(name);
+        if (stats)
+            vle_info(ctx, "Live statistics in %s\n", name.c_str());
+        else
+            vle_info(ctx, "Failed to create the shared memory segment %s\n",
+                     name.c_str());
+    }
+
+    if (!stats)
+        stats = std::make_shared <bench::StatsSegment>();
+
+    common->emplace("stats-segment", stats);
 
     for (int i = ::optind; i < argc; ++i) {
         vle_info(ctx, "Run for %s\n", argv[i]);
@@ -391,29 +1388,170 @@ static int main_mono_mode(const vle::Context& ctx, int argc, char *argv[])
         double total_duration = 0.0;
         Sample sample(mp.counter);
 
+        bench::Topology topology;
+        bench::CriticalPath critical_path;
+        double total_bound = 0.0;
+        bench::ModelProfile model_profile;
+        if (recorder) {
+            try {
+                topology = bench::topology_read(argv[i]);
+            } catch (const std::exception& e) {
+                vle_info(ctx, "%s\n", e.what());
+                vle_info(ctx, "Simulation failure\n");
+                return -ECANCELED;
+            }
+        }
+
+        if (perf)
+            perf->clear();
+
+        std::unique_ptr <bench::Migration> migration;
+        std::string migration_directory;
+        bench::LoadReport checkpoint_load;
+        long int first_migration = -1, last_migration = -1;
+        if (mp.migrate) {
+            char directory[] = "/tmp/echll-migration-XXXXXX";
+            if (!::mkdtemp(directory)) {
+                vle_info(ctx, "Failed to create the migration directory\n");
+                return -EIO;
+            }
+
+            migration_directory = std::string(directory) + '/';
+
+            try {
+                migration.reset(new bench::Migration(argv[i]));
+            } catch (const std::exception& e) {
+                vle_info(ctx, "%s\n", e.what());
+                ::rmdir(directory);
+                vle_info(ctx, "Simulation failure\n");
+                return -ECANCELED;
+            }
+        }
+
+        RunSample run_sample;
+        Throughput throughput;
+        std::map <int, std::pair <double, double>> work;
+        bench::LoadReport load_report;
+        double build_time = 0.0;
+        double largest_build_time = 0.0;
+
         for (long int run = 0; run < mp.counter; ++run) {
             bench::DSDE dsde_engine(common);
 
-            if (mp.use_thread_root) {             // TODO improve !
-                bench::Timer timer(&sample.sample[run]);
-                bench::RootThread root(ctx, mp.thread_number);
-                vle::Simulation <bench::DSDE> sim(ctx, dsde_engine, root);
-                sim.run(mp.simulation_begin,
-                        mp.simulation_duration + mp.simulation_begin);
-            } else {
-                bench::Timer timer(&sample.sample[run]);
-                bench::RootMono root(ctx, mp.thread_number);
-                vle::Simulation <bench::DSDE> sim(ctx, dsde_engine, root);
-                sim.run(mp.simulation_begin,
-                        mp.simulation_duration + mp.simulation_begin);
+            if (recorder)
+                recorder->clear();
+
+            if (workload)
+                workload->clear();
+
+            if (load)
+                load->clear();
+
+            bench::AllocationStats memory_begin;
+            RunSample::time_point time_begin;
+            if (memory) {
+                memory->clear();
+                bench::memory_reset_peak_rss();
+                memory_begin = bench::allocation_snapshot();
+            }
+            if (phases)
+                time_begin = std::chrono::steady_clock::now();
+
+            bench::stats_replicate(*stats, i - ::optind, run, mp.counter,
+                                   mp.simulation_begin);
+
+            std::map <std::string, bench::Profiler::Stat> profile;
+            if (mp.profile)
+                profile = bench::Profiler::instance().names();
+
+            Replicate replicate;
+            if (mp.use_thread_root)
+                main_replicate <bench::RootThread>(ctx, mp, dsde_engine,
+                                                   perf.get(), memory.get(),
+                                                   *stats, replicate);
+            else
+                main_replicate <bench::RootMono>(ctx, mp, dsde_engine,
+                                                 perf.get(), memory.get(),
+                                                 *stats, replicate);
+
+            sample.sample[run] = replicate.duration;
+            build_time += replicate.build_time;
+            largest_build_time += replicate.largest_build_time;
+            throughput.add(replicate);
+
+            if (workload)
+                workload->accumulate(work);
+
+            if (load)
+                load->accumulate(load_report);
+
+            if (migration) {
+                load->accumulate(checkpoint_load);
+
+                if ((run + 1) % mp.migration.every == 0 &&
+                    run + 1 < mp.counter) {
+                    try {
+                        if (main_migrate(mp, *migration, run,
+                                         checkpoint_load,
+                                         migration_directory, *common)) {
+                            if (first_migration < 0)
+                                first_migration = run;
+                            last_migration = run;
+                        }
+                    } catch (const std::exception& e) {
+                        vle_info(ctx, "%s\n", e.what());
+                        main_migration_remove(*migration, migration_directory);
+                        vle_info(ctx, "Simulation failure\n");
+                        return -ECANCELED;
+                    }
+
+                    checkpoint_load = bench::LoadReport();
+                }
             }
 
+            if (mp.profile)
+                main_profile_print(mp.output, run, profile,
+                                   bench::Profiler::instance().names());
+
+            if (phases)
+                run_sample.add(memory.get(), memory_begin,
+                               replicate.memory_simulation,
+                               memory ? bench::allocation_snapshot() :
+                               bench::AllocationStats(), time_begin,
+                               replicate.time_simulation_start,
+                               replicate.time_simulation,
+                               std::chrono::steady_clock::now());
+
             if (sample.sample[run] < 0.0) {
+                if (migration)
+                    main_migration_remove(*migration, migration_directory);
                 vle_info(ctx, "Simulation failure\n");
                 return -ECANCELED;
             }
 
             total_duration += sample.sample[run];
+
+            if (!mp.repartition.empty())
+                model_profile.add(topology, *recorder);
+
+            if (mp.analysis) {
+                bench::CriticalPath replicate_path;
+                try {
+                    replicate_path = bench::critical_path(
+                        topology, *recorder, mp.duration,
+                        static_cast <std::size_t>(
+                            std::ceil(mp.simulation_duration)));
+                } catch (const std::exception& e) {
+                    vle_info(ctx, "%s\n", e.what());
+                    if (migration)
+                        main_migration_remove(*migration, migration_directory);
+                    vle_info(ctx, "Simulation failure\n");
+                    return -ECANCELED;
+                }
+
+                total_bound += replicate_path.bound(mp.thread_number);
+                critical_path.add(replicate_path);
+            }
         }
 
         auto result = sample.compute();
@@ -421,6 +1559,383 @@ static int main_mono_mode(const vle::Context& ctx, int argc, char *argv[])
         std::fprintf(mp.output, "%f;%f;%f;%f\n",
                      total_duration, result.mean, result.variance,
                      result.standard_deviation);
+
+        throughput.print(mp.output, mp.counter);
+
+        if (workload)
+            bench::workload_print(mp.output, work, mp.counter);
+
+        if (mp.imbalance)
+            load_report.print(mp.output, mp.counter);
+
+        if (migration) {
+            main_migration_print(mp, sample, first_migration, last_migration);
+
+            main_migration_remove(*migration, migration_directory);
+            common->erase("model-origin");
+            common->erase("tgf-directory");
+        }
+
+        if (!mp.repartition.empty()) {
+            int ret = main_repartition(ctx, mp, argv[i], model_profile,
+                                       result.mean);
+            if (ret)
+                return ret;
+        }
+
+        if (mp.profile) {
+            for (const auto& region : bench::Profiler::instance().paths())
+                std::fprintf(mp.output, "region;%s;%u;%" PRIuMAX ";%f\n",
+                             region.first.c_str(), region.second.threads,
+                             static_cast <std::uintmax_t>(region.second.count),
+                             region.second.milliseconds());
+        }
+
+        if (mp.prebuild) {
+            double n = static_cast <double>(mp.counter);
+
+            std::fprintf(mp.output, "build;%f;%f\n", build_time / n,
+                         largest_build_time / n);
+        }
+
+        if (mp.memory)
+            run_sample.print_memory(mp.output);
+
+        if (phases)
+            run_sample.print_phases(mp.output);
+
+        if (perf) {
+            typedef bench::PerfCounters pc;
+            double cycles = perf->mean(pc::CYCLES);
+            double instructions = perf->mean(pc::INSTRUCTIONS);
+
+            std::fprintf(mp.output, "perf;%.0f;%.0f;%f;%.0f;%.0f;%.0f;%.0f\n",
+                         cycles, instructions,
+                         (cycles > 0.0 && instructions >= 0.0) ?
+                         instructions / cycles : -1.0,
+                         perf->mean(pc::LLC_MISSES),
+                         perf->mean(pc::BRANCH_MISSES),
+                         perf->mean(pc::CONTEXT_SWITCHES),
+                         perf->mean(pc::CPU_MIGRATIONS));
+        }
+
+        if (mp.analysis) {
+            double bound = total_bound / static_cast <double>(mp.counter);
+
+            critical_path.divide(static_cast <std::size_t>(mp.counter));
+
+            std::fprintf(mp.output, "critical-path;%" PRIuMAX ";%f;%f;%f;%f;%"
+                         PRIuMAX ";%lu;%f;%f;%f;%f\n",
+                         static_cast <std::uintmax_t>(critical_path.steps.size()),
+                         critical_path.work(), critical_path.span(),
+                         critical_path.level_span(),
+                         critical_path.parallelism(),
+                         static_cast <std::uintmax_t>(critical_path.max_width()),
+                         mp.thread_number, bound,
+                         bound > 0.0 ? critical_path.work() / bound : 0.0,
+                         result.mean,
+                         result.mean > 0.0 ? bound / result.mean : 0.0);
+
+            for (std::size_t k = 0, e = critical_path.steps.size(); k != e; ++k) {
+                const auto& step = critical_path.steps[k];
+
+                std::fprintf(mp.output, "critical-path-step;%" PRIuMAX
+                             ";%f;%f;%f;%f;%" PRIuMAX "\n",
+                             static_cast <std::uintmax_t>(k), step.work,
+                             step.span, step.level_span, step.parallelism(),
+                             static_cast <std::uintmax_t>(step.max_width));
+            }
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * Write the MPI report: the mean wall time of a run and, for the logical
+ * processors, the mean counters of each rank (@e stats, summed over the
+ * @e counter runs and indexed by rank, rank 0 being the coordinator).
+ */
+static void main_mpi_report(const main_parameter& mp, int size,
+                            std::size_t partitions, long int counter,
+                            double wall,
+                            const std::vector <bench::LogicalProcessorStats>& stats)
+{
+    const double runs = static_cast <double>(std::max(1l, counter));
+
+    std::fprintf(mp.output, "mpi;%s;%d;%zu;%f\n", mp.protocol.name(), size,
+                 partitions, wall / runs);
+
+    if (stats.empty())
+        return;
+
+    bench::LogicalProcessorStats total;
+
+    for (std::size_t rank = 1; rank < stats.size(); ++rank) {
+        const auto& rs = stats[rank];
+
+        std::fprintf(mp.output, "mpi-rank;%zu;%f;%f;%f;%f;%f;%f\n", rank,
+                     rs.events / runs, rs.packets / runs,
+                     rs.null_messages / runs, rs.messages / runs,
+                     rs.claims / runs, rs.blocked / runs);
+
+        total.events += rs.events;
+        total.packets += rs.packets;
+        total.null_messages += rs.null_messages;
+        total.serialized += rs.serialized;
+        total.serialized_bytes += rs.serialized_bytes;
+        total.serialization += rs.serialization;
+    }
+
+    for (std::size_t rank = 1; rank < stats.size(); ++rank) {
+        const auto& rs = stats[rank];
+        double sends = static_cast <double>(rs.packets + rs.null_messages);
+
+        std::fprintf(mp.output, "mpi-traffic;%zu;%f;%f;%f;%f;%f;%f\n", rank,
+                     sends / runs, rs.bytes / runs,
+                     sends > 0 ? rs.bytes / sends : 0.0, rs.blocked / runs,
+                     rs.overlapped / runs, rs.shared / runs);
+    }
+
+    std::fprintf(mp.output, "mpi-serialization;%s;%f;%f;%f;%f;%f\n",
+                 mp.protocol.flat && bench::LinkCodec::flat_data ? "flat" :
+                 "archive", total.serialized / runs,
+                 total.serialized_bytes / runs, total.serialization / runs,
+                 total.serialized ? total.serialization * 1e3 /
+                 total.serialized : 0.0,
+                 total.serialization > 0 ? total.serialized_bytes * 1e-3 /
+                 total.serialization : 0.0);
+
+    if (stats.size() > 1 && stats[1].windows) {
+        const double time = mp.simulation_duration;
+
+        std::fprintf(mp.output, "mpi-window;%f;%f;%f;%f\n",
+                     stats[1].windows / runs, stats[1].windows / runs / time,
+                     stats[1].window / stats[1].windows,
+                     stats[1].synchronization * 1e3 / stats[1].windows);
+    }
+
+    double sent = static_cast <double>(total.packets + total.null_messages);
+
+    std::fprintf(mp.output, "mpi-overhead;%f;%f;%f;%f;%f\n",
+                 total.events / runs, total.packets / runs,
+                 total.null_messages / runs,
+                 sent > 0 ? total.null_messages / sent : 0.0,
+                 total.events ? static_cast <double>(total.null_messages) /
+                 total.events : 0.0);
+}
+
+/**
+ * Gather on rank 0 the loads of the steps of the run of the logical
+ * processors (cleared) and add them into @e report: a step is a time of
+ * events of any partition.
+ */
+static void main_mpi_steps(const boost::mpi::communicator& comm,
+                           std::size_t partitions,
+                           bench::LogicalProcessorStats& stats,
+                           bench::LoadReport& report)
+{
+    std::vector <std::vector <bench::StepLoad>> all;
+
+    boost::mpi::gather(comm, stats.steps, all, 0);
+    stats.steps.clear();
+
+    if (comm.rank() != 0)
+        return;
+
+    std::map <double, std::vector <double>> steps;
+
+    for (std::size_t rank = 1; rank < all.size() && rank <= partitions; ++rank) {
+        for (const auto& step : all[rank]) {
+            auto& load = steps[step.time];
+
+            load.resize(partitions, 0.0);
+            load[rank - 1] += step.load;
+        }
+    }
+
+    for (const auto& step : steps)
+        report.step(step.second);
+}
+
+/**
+ * Run the sub-coupled models on logical processors (-u null-message, -u
+ * window or -u aggregated): rank 0 checks the graph and measures the runs,
+ * rank @e i + 1 simulates the sub-coupled model @e i of @e rootfile.
+ */
+static int main_mpi_logical_processor(const vle::Context& ctx,
+                                      main_parameter& mp,
+                                      const std::string& rootfile)
+{
+    boost::mpi::communicator comm;
+    bench::TGF root;
+    bench::PartitionLinks links;
+    bench::LogicalProcessorStats stats;
+    std::string childfile;
+    int ok = 1;
+    int child = comm.rank() - 1;
+
+    try {
+        root = bench::tgf_read(rootfile);
+
+        if (comm.rank() == 0) {
+            if (root.models.size() + 1 > static_cast <std::size_t>(comm.size()))
+                throw std::invalid_argument("MPI size < children size");
+
+            if (mp.protocol.lookahead <= 0.0 &&
+                !bench::topology_acyclic(bench::topology_read(rootfile)))
+                throw std::invalid_argument("the atomic graph has a cycle: "
+                                            "give a positive lookahead");
+        } else if (child < static_cast <int>(root.models.size())) {
+            childfile = bench::tgf_child_filename(rootfile, child);
+            links = bench::partition_links(root, bench::tgf_read(childfile),
+                                           child);
+        }
+    } catch (const std::exception& e) {
+        std::fprintf(stderr, "%s: %s\n", mp.protocol.name(), e.what());
+        ok = 0;
+    }
+
+    ok = boost::mpi::all_reduce(comm, ok, boost::mpi::minimum <int>());
+    if (!ok)
+        return -1;
+
+    bool worker = comm.rank() > 0 &&
+        child < static_cast <int>(root.models.size());
+    boost::mpi::communicator workers = comm.split(worker ? 0 : 1);
+    std::unique_ptr <bench::ShmTransport> shm;
+
+    if (worker && mp.protocol.shm)
+        shm = bench::AggregatedLogicalProcessor::transport(links, workers,
+                                                           mp.protocol.ring);
+
+    double wall = 0.0;
+    bench::LoadReport load_report;
+
+    stats.record_steps = mp.imbalance && worker;
+
+    for (long int run = 0; run < mp.counter; ++run) {
+        if (comm.rank() == 0) {
+            comm.barrier();
+            auto start = std::chrono::steady_clock::now();
+            comm.barrier();
+            wall += std::chrono::duration <double, std::milli>(
+                std::chrono::steady_clock::now() - start).count();
+
+            if (mp.imbalance)
+                main_mpi_steps(comm, root.models.size(), stats, load_report);
+            continue;
+        }
+
+        std::shared_ptr <bench::Factory> factory = main_factory_new(ctx, mp, false);
+        vle::CommonPtr common = main_common_new(mp, factory);
+
+        common->operator[]("name") = vle::stringf("S%d", child);
+        common->operator[]("id") = child;
+        common->operator[]("tgf-filesource") = childfile;
+
+        std::shared_ptr <bench::LoadStats> load;
+        if (mp.imbalance && worker) {
+            load = std::make_shared <bench::LoadStats>();
+            common->emplace("partition-load", load);
+        }
+
+        comm.barrier();
+
+        if (worker) {
+            try {
+                bench::Factory::modelptr coupled = factory->get("coupled");
+
+                if (mp.protocol.type == bench::MpiProtocol::AGGREGATED) {
+                    bench::AggregatedLogicalProcessor lp(*common, links,
+                                                         mp.protocol, workers,
+                                                         shm.get(), stats);
+                    lp.run(*coupled, mp.simulation_begin,
+                           mp.simulation_begin + mp.simulation_duration);
+                } else if (mp.protocol.type == bench::MpiProtocol::WINDOW) {
+                    bench::WindowLogicalProcessor lp(*common, links,
+                                                     mp.protocol, workers,
+                                                     stats);
+                    lp.run(*coupled, mp.simulation_begin,
+                           mp.simulation_begin + mp.simulation_duration);
+                } else {
+                    bench::NullMessageLogicalProcessor lp(*common, links,
+                                                          mp.protocol, stats);
+                    lp.run(*coupled, mp.simulation_begin,
+                           mp.simulation_begin + mp.simulation_duration);
+                }
+            } catch (const std::exception& e) {
+                std::fprintf(stderr, "%s: rank %d: %s\n", mp.protocol.name(),
+                             comm.rank(), e.what());
+                boost::mpi::environment::abort(EXIT_FAILURE);
+            }
+        }
+
+        comm.barrier();
+
+        if (load)
+            stats.busy += load->busy(child);
+
+        if (mp.imbalance)
+            main_mpi_steps(comm, root.models.size(), stats, load_report);
+    }
+
+    std::vector <bench::LogicalProcessorStats> all;
+    boost::mpi::gather(comm, stats, all, 0);
+
+    if (comm.rank() == 0)
+        main_mpi_report(mp, comm.size(), root.models.size(), mp.counter,
+                        wall, all);
+
+    if (mp.imbalance && comm.rank() == 0) {
+        for (std::size_t rank = 1;
+             rank < all.size() && rank <= root.models.size(); ++rank) {
+            const auto& rs = all[rank];
+
+            load_report.add(rank - 1, rs.busy,
+                            std::max(0.0, rs.processing - rs.busy) +
+                            rs.serialization, rs.blocked);
+        }
+
+        load_report.print(mp.output, mp.counter);
+    }
+
+    if (mp.protocol.sync != bench::SyncTree::COLLECTIVE) {
+        std::vector <bench::SyncSample> samples;
+
+        if (worker)
+            samples = bench::sync_benchmark(workers, mp.protocol.fanout);
+
+        if (comm.rank() == 1)
+            comm.send(0, 0, samples);
+        else if (comm.rank() == 0)
+            comm.recv(1, 0, samples);
+
+        if (comm.rank() == 0)
+            for (const auto& sample : samples)
+                std::fprintf(mp.output, "mpi-sync;%s;%d;%d;%f\n",
+                             bench::SyncTree::name(
+                                 static_cast <bench::SyncTree::Layout>(
+                                     sample.layout)),
+                             sample.ranks, sample.fanout, sample.latency);
+    }
+
+    if (mp.protocol.shm) {
+        std::vector <bench::TransportSample> samples;
+
+        if (worker)
+            samples = bench::transport_benchmark(workers, mp.protocol.ring);
+
+        if (comm.rank() == 1)
+            comm.send(0, 0, samples);
+        else if (comm.rank() == 0)
+            comm.recv(1, 0, samples);
+
+        if (comm.rank() == 0)
+            for (const auto& sample : samples)
+                std::fprintf(mp.output, "mpi-transport;%s;%" PRIu64
+                             ";%f;%f\n", sample.shm ? "shm" : "mpi",
+                             sample.bytes, sample.latency, sample.throughput);
     }
 
     return 0;
@@ -431,41 +1946,80 @@ static int main_mpi_mode(const vle::Context& ctx, int rank, int size,
 {
     main_parameter mp = main_getopt(ctx, argc, argv);
 
+    if (mp.calibrate)
+        bench::sleep_and_work_calibrate(rank == 0 ? mp.output : nullptr,
+                                        calibration_tolerance);
+
+    if (mp.protocol.type != bench::MpiProtocol::SYNCHRONOUS) {
+        if (rank == 0) {
+            vle_info(ctx, "MPI mode activated: %d/%d\n", rank, size);
+            mp.print(ctx);
+        }
+
+        return main_mpi_logical_processor(ctx, mp, argv[::optind]);
+    }
+
+    boost::mpi::communicator comm;
+    std::size_t children = 0;
+    double wall = 0.0;
+
     if (rank == 0) {
         vle_info(ctx, "MPI mode activated: %d/%d\n", rank, size);
         mp.print(ctx);
+        children = bench::tgf_read(argv[::optind]).models.size();
+    } else {
+        vle_info(ctx, "Need to start SynchronousProxyModel %d", rank);
+    }
 
-        std::shared_ptr <bench::Factory> factory = main_factory_new(ctx, mp, true);
-        vle::CommonPtr common = main_common_new(mp.duration, factory);
+    for (long int run = 0; run < mp.counter; ++run) {
+        if (rank == 0) {
+            std::shared_ptr <bench::Factory> factory = main_factory_new(ctx, mp, true);
+            vle::CommonPtr common = main_common_new(mp, factory);
 
-        common->at("tgf-filesource") = std::string(argv[::optind]);
-        bench::DSDE dsde_engine(common);
+            common->at("tgf-filesource") = std::string(argv[::optind]);
+            bench::DSDE dsde_engine(common);
+
+            comm.barrier();
+            auto start = std::chrono::steady_clock::now();
+
+            if (mp.use_thread_root) {
+                bench::RootMPIThread root(ctx);
+                vle::Simulation <bench::DSDE> sim(ctx, dsde_engine, root);
+                sim.run(mp.simulation_begin,
+                        mp.simulation_begin + mp.simulation_duration);
+            } else {
+                bench::RootMPIMono root(ctx);
+                vle::Simulation <bench::DSDE> sim(ctx, dsde_engine, root);
+                sim.run(mp.simulation_begin,
+                        mp.simulation_begin + mp.simulation_duration);
+            }
 
-        if (mp.use_thread_root) {
-            bench::RootMPIThread root(ctx);
-            vle::Simulation <bench::DSDE> sim(ctx, dsde_engine, root);
-            sim.run(mp.simulation_begin,
-                    mp.simulation_duration - mp.simulation_begin);
+            comm.barrier();
+            wall += std::chrono::duration <double, std::milli>(
+                std::chrono::steady_clock::now() - start).count();
         } else {
-            bench::RootMPIMono root(ctx);
-            vle::Simulation <bench::DSDE> sim(ctx, dsde_engine, root);
-            sim.run(mp.simulation_begin,
-                    mp.simulation_duration - mp.simulation_begin);
-        }
-    } else {
-        vle_info(ctx, "Need to start SynchronousProxyModel %d", rank);
-        std::shared_ptr <bench::Factory> factory = main_factory_new(ctx, mp, false);
-        vle::CommonPtr common = main_common_new(mp.duration, factory);
+            std::shared_ptr <bench::Factory> factory = main_factory_new(ctx, mp, false);
+            vle::CommonPtr common = main_common_new(mp, factory);
 
-        common->operator[]("name") = vle::stringf("S%d", rank - 1);
-        common->operator[]("tgf-filesource") = vle::stringf("S%d.tgf", rank - 1);
+            common->operator[]("name") = vle::stringf("S%d", rank - 1);
+            common->operator[]("id") = rank - 1;
+            common->operator[]("tgf-filesource") = vle::stringf("S%d.tgf", rank - 1);
 
-        bench::SynchronousLogicalProcessor sp(common);
-        bench::Factory::modelptr coupled = factory->get("coupled");
-        sp.parent = 0;
-        sp.run(*coupled);
+            comm.barrier();
+
+            bench::SynchronousLogicalProcessor sp(common);
+            bench::Factory::modelptr coupled = factory->get("coupled");
+            sp.parent = 0;
+            sp.run(*coupled);
+
+            comm.barrier();
+        }
     }
 
+    if (rank == 0)
+        main_mpi_report(mp, size, children, mp.counter, wall,
+                        std::vector <bench::LogicalProcessorStats>());
+
     return 0;
 }
 
@@ -479,6 +2033,8 @@ int main(int argc, char *argv[])
     vle::Context ctx = std::make_shared <vle::ContextImpl>();
     ctx->set_log_priority(3);
 
+    bench::ProfileClock::ticks_per_millisecond();
+
     int ret;
 
     if (comm.size() == 1)
@@ -0,0 +1,241 @@
+/*
+ * Copyright (C) 2014 INRA
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "memory.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+namespace {
+
+/*
+ * One shard of counters per cache line. A thread takes a shard at its first
+ * allocation and keeps it: threads only share a shard when more than
+ * shard_number threads allocate.
+ */
+const unsigned int shard_number = 64;
+
+struct alignas(64) Shard
+{
+    std::atomic <std::uint64_t> allocations;
+    std::atomic <std::uint64_t> deallocations;
+    std::atomic <std::uint64_t> bytes;
+    std::atomic <std::uint64_t> freed_bytes;
+};
+
+Shard shards[shard_number];
+std::atomic <unsigned int> next_shard(0);
+std::atomic <bool> tracking(false);
+thread_local int thread_shard = -1;
+
+inline Shard& shard()
+{
+    if (thread_shard < 0)
+        thread_shard = static_cast <int>(next_shard.fetch_add(1) %
+                                         shard_number);
+
+    return shards[thread_shard];
+}
+
+inline std::size_t usable_size(void *ptr, std::size_t size)
+{
+#if defined(__GLIBC__)
+    (void)size;
+    return ::malloc_usable_size(ptr);
+#else
+    (void)ptr;
+    return size;
+#endif
+}
+
+inline void* allocate(std::size_t size)
+{
+    if (size == 0)
+        size = 1;
+
+    void *ret;
+    while ((ret = std::malloc(size)) == nullptr) {
+        std::new_handler handler = std::get_new_handler();
+        if (!handler)
+            throw std::bad_alloc();
+
+        handler();
+    }
+
+    if (tracking.load(std::memory_order_relaxed)) {
+        Shard& s = shard();
+        s.allocations.fetch_add(1, std::memory_order_relaxed);
+        s.bytes.fetch_add(usable_size(ret, size), std::memory_order_relaxed);
+    }
+
+    return ret;
+}
+
+inline void deallocate(void *ptr)
+{
+    if (!ptr)
+        return;
+
+    if (tracking.load(std::memory_order_relaxed)) {
+        Shard& s = shard();
+        s.deallocations.fetch_add(1, std::memory_order_relaxed);
+        s.freed_bytes.fetch_add(usable_size(ptr, 0),
+                                std::memory_order_relaxed);
+    }
+
+    std::free(ptr);
+}
+
+std::uint64_t read_status(const char *key)
+{
+    FILE *file = std::fopen("/proc/self/status", "r");
+    if (!file)
+        return 0;
+
+    char line[256];
+    std::size_t length = std::strlen(key);
+    std::uint64_t ret = 0;
+
+    while (std::fgets(line, sizeof(line), file)) {
+        if (std::strncmp(line, key, length) == 0) {
+            ret = std::strtoull(line + length, nullptr, 10) * 1024u;
+            break;
+        }
+    }
+
+    std::fclose(file);
+
+    return ret;
+}
+
+}
+
+namespace bench {
+
+void allocation_tracking(bool enable)
+{
+    tracking.store(enable);
+}
+
+AllocationStats allocation_snapshot()
+{
+    AllocationStats ret;
+
+    for (const Shard& s : shards) {
+        ret.allocations += s.allocations.load(std::memory_order_relaxed);
+        ret.deallocations += s.deallocations.load(std::memory_order_relaxed);
+        ret.bytes += s.bytes.load(std::memory_order_relaxed);
+        ret.freed_bytes += s.freed_bytes.load(std::memory_order_relaxed);
+    }
+
+    return ret;
+}
+
+std::uint64_t memory_rss()
+{
+    return read_status("VmRSS:");
+}
+
+std::uint64_t memory_peak_rss()
+{
+    return read_status("VmHWM:");
+}
+
+bool memory_reset_peak_rss()
+{
+    FILE *file = std::fopen("/proc/self/clear_refs", "w");
+    if (!file)
+        return false;
+
+    bool ret = std::fputs("5", file) >= 0;
+
+    return std::fclose(file) == 0 && ret;
+}
+
+}
+
+void* operator new(std::size_t size)
+{
+    return allocate(size);
+}
+
+void* operator new[](std::size_t size)
+{
+    return allocate(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+    try {
+        return allocate(size);
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+    try {
+        return allocate(size);
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+void operator delete(void *ptr) noexcept
+{
+    deallocate(ptr);
+}
+
+void operator delete[](void *ptr) noexcept
+{
+    deallocate(ptr);
+}
+
+void operator delete(void *ptr, std::size_t) noexcept
+{
+    deallocate(ptr);
+}
+
+void operator delete[](void *ptr, std::size_t) noexcept
+{
+    deallocate(ptr);
+}
+
+void operator delete(void *ptr, const std::nothrow_t&) noexcept
+{
+    deallocate(ptr);
+}
+
+void operator delete[](void *ptr, const std::nothrow_t&) noexcept
+{
+    deallocate(ptr);
+}
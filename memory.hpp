@@ -0,0 +1,141 @@
+/*
+ * Copyright (C) 2014 INRA
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __Benchmark_memory_hpp__
+#define __Benchmark_memory_hpp__
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace bench {
+
+/**
+ * @e AllocationStats are the numbers of calls and bytes of the global
+ * operator new and operator delete since the start of the process.
+ */
+struct AllocationStats
+{
+    std::uint64_t allocations = 0;
+    std::uint64_t deallocations = 0;
+    std::uint64_t bytes = 0;
+    std::uint64_t freed_bytes = 0;
+
+    /** Bytes allocated and not released. */
+    std::int64_t live_bytes() const
+    {
+        return static_cast <std::int64_t>(bytes) -
+            static_cast <std::int64_t>(freed_bytes);
+    }
+
+    AllocationStats operator-(const AllocationStats& other) const
+    {
+        AllocationStats ret;
+
+        ret.allocations = allocations - other.allocations;
+        ret.deallocations = deallocations - other.deallocations;
+        ret.bytes = bytes - other.bytes;
+        ret.freed_bytes = freed_bytes - other.freed_bytes;
+
+        return ret;
+    }
+};
+
+/**
+ * Start or stop the accounting of the global operator new and delete
+ * (defined in memory.cpp). The counters are per thread shards, so the
+ * accounting does not serialize the allocations of the worker threads.
+ * When stopped, the cost is a relaxed load by allocation.
+ */
+void allocation_tracking(bool enable);
+
+/** Sum of the per thread counters. */
+AllocationStats allocation_snapshot();
+
+/** Resident set size and its peak (VmRSS, VmHWM) in bytes, 0 on failure. */
+std::uint64_t memory_rss();
+std::uint64_t memory_peak_rss();
+
+/**
+ * Reset the peak resident set size to the current one (Linux >= 4.0, write
+ * `5' into /proc/self/clear_refs). Returns false if not supported.
+ */
+bool memory_reset_peak_rss();
+
+/**
+ * @e MemoryProbe is shared by the atomic models of a run (the
+ * `memory-probe' parameter) to count the models and the transitions and to
+ * take the allocation snapshot and the time at the first transition, i.e.
+ * at the end of the construction of the model tree.
+ */
+struct MemoryProbe
+{
+    MemoryProbe()
+        : models(0)
+        , transitions(0)
+        , m_started(false)
+    {}
+
+    void clear()
+    {
+        models.store(0, std::memory_order_relaxed);
+        transitions.store(0, std::memory_order_relaxed);
+        m_started.store(false);
+    }
+
+    void init()
+    {
+        models.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void transition()
+    {
+        if (!m_started.load(std::memory_order_relaxed) &&
+            !m_started.exchange(true)) {
+            simulation_start = allocation_snapshot();
+            simulation_start_time = std::chrono::steady_clock::now();
+        }
+
+        transitions.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    bool started() const
+    {
+        return m_started.load();
+    }
+
+    std::atomic <std::uint64_t> models;
+    std::atomic <std::uint64_t> transitions;
+    AllocationStats simulation_start;
+    std::chrono::steady_clock::time_point simulation_start_time;
+
+private:
+    std::atomic <bool> m_started;
+};
+
+}
+
+#endif
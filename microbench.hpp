@@ -0,0 +1,149 @@
+/*
+ * Copyright (C) 2014 INRA
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __Benchmark_microbench_hpp__
+#define __Benchmark_microbench_hpp__
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace bench {
+
+/** Keep @e value (and the computation of @e value) alive. */
+template <typename T>
+inline void do_not_optimize(const T& value)
+{
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+/** Results of a microbenchmark, in nanoseconds per operation. */
+struct MicrobenchResult
+{
+    std::string name;
+    std::uint64_t batch = 0;
+    std::size_t samples = 0;
+    double median = 0.0;
+    double p10 = 0.0;
+    double p90 = 0.0;
+    double p99 = 0.0;
+    double min = 0.0;
+};
+
+/**
+ * @e Microbench times a function by batches: the size of a batch is
+ * doubled until a batch lasts @e sample_ms, the function is warmed up
+ * during @e warmup_ms, then @e samples batches are timed. The results are
+ * the percentiles of the time per call over the batches.
+ */
+struct Microbench
+{
+    double sample_ms = 2.0;
+    double warmup_ms = 20.0;
+    std::size_t samples = 51;
+
+    template <typename Function>
+    MicrobenchResult run(const std::string& name, Function function) const
+    {
+        MicrobenchResult ret;
+        std::uint64_t batch = 1;
+        double elapsed;
+
+        for (;;) {
+            elapsed = time(function, batch);
+            if (elapsed >= sample_ms * 1e6 || batch >= (1ull << 40))
+                break;
+
+            /* Jump close to the target when the batch is already long
+             * enough to be measured. */
+            if (elapsed > 1e4)
+                batch = std::max(batch * 2, static_cast <std::uint64_t>(
+                        batch * sample_ms * 1e6 / elapsed));
+            else
+                batch *= 2;
+        }
+
+        for (double warmup = 0.0; warmup < warmup_ms * 1e6; )
+            warmup += time(function, batch);
+
+        std::vector <double> values(std::max <std::size_t>(1, samples));
+        for (auto& value : values)
+            value = time(function, batch) / static_cast <double>(batch);
+
+        std::sort(values.begin(), values.end());
+
+        ret.name = name;
+        ret.batch = batch;
+        ret.samples = values.size();
+        ret.median = percentile(values, 0.5);
+        ret.p10 = percentile(values, 0.1);
+        ret.p90 = percentile(values, 0.9);
+        ret.p99 = percentile(values, 0.99);
+        ret.min = values.front();
+
+        return ret;
+    }
+
+    /** Writes `microbench;name;batch;samples;median;p10;p90;p99;min'. */
+    static void print(FILE *output, const MicrobenchResult& result)
+    {
+        std::fprintf(output, "microbench;%s;%llu;%zu;%f;%f;%f;%f;%f\n",
+                     result.name.c_str(),
+                     static_cast <unsigned long long>(result.batch),
+                     result.samples, result.median, result.p10, result.p90,
+                     result.p99, result.min);
+    }
+
+private:
+    template <typename Function>
+    static double time(Function& function, std::uint64_t batch)
+    {
+        auto start = std::chrono::steady_clock::now();
+
+        for (std::uint64_t i = 0; i != batch; ++i)
+            function();
+
+        auto end = std::chrono::steady_clock::now();
+
+        return std::chrono::duration <double, std::nano>(end - start).count();
+    }
+
+    /* Nearest rank of a sorted vector. */
+    static double percentile(const std::vector <double>& values, double p)
+    {
+        std::size_t rank = static_cast <std::size_t>(
+            p * static_cast <double>(values.size() - 1) + 0.5);
+
+        return values[std::min(rank, values.size() - 1)];
+    }
+};
+
+}
+
+#endif
@@ -0,0 +1,497 @@
+/*
+ * Copyright (C) 2014 INRA
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __Benchmark_migration_hpp__
+#define __Benchmark_migration_hpp__
+
+#include "tgf.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace bench {
+
+/**
+ * @e MigrationPolicy is the `every=K,threshold=F,moves=F' parameter of the
+ * migration: a checkpoint after every @e every runs, a migration if the
+ * imbalance factor (max / mean) of the load of the partitions is above
+ * @e threshold, at most the fraction @e moves of the models of a partition
+ * moved by checkpoint.
+ */
+struct MigrationPolicy
+{
+    long int every = 1;
+    double threshold = 1.1;
+    double moves = 0.25;
+
+    /** Read `key=value[,key=value...]'. Returns false on error. */
+    bool parse(const std::string& spec)
+    {
+        std::size_t begin = 0;
+
+        while (begin < spec.size()) {
+            std::size_t end = spec.find(',', begin);
+            if (end == std::string::npos)
+                end = spec.size();
+
+            std::string token = spec.substr(begin, end - begin);
+            begin = end + 1;
+
+            std::size_t equal = token.find('=');
+            if (equal == std::string::npos)
+                return false;
+
+            std::string key = token.substr(0, equal);
+            const char *value = token.c_str() + equal + 1;
+            char *nptr;
+            double number = std::strtod(value, &nptr);
+            if (nptr == value || *nptr != '\0' || number <= 0.0)
+                return false;
+
+            if (key == "every")
+                every = std::max(1l, static_cast <long int>(number));
+            else if (key == "threshold")
+                threshold = std::max(1.0, number);
+            else if (key == "moves")
+                moves = std::min(number, 1.0);
+            else
+                return false;
+        }
+
+        return true;
+    }
+};
+
+/**
+ * @e ModelOrigin is the identity of the children of the migrated
+ * sub-coupled models (the `model-origin' parameter): the partition and the
+ * identifier of each child in the original files, indexed by root child
+ * and by child. A migrated model keeps its name, its cost, its generator
+ * and its trace, so the migration does not change the results.
+ */
+struct ModelOrigin
+{
+    struct Identity
+    {
+        int partition;
+        int id;
+    };
+
+    std::vector <std::string> names;                    /* `S%d' by partition. */
+    std::vector <std::vector <Identity>> children;      /* by root child. */
+
+    /** The identity of the child @e child of @e partition or nullptr. */
+    const Identity* find(int partition, int child) const
+    {
+        if (partition < 0 || static_cast <std::size_t>(partition) >=
+            children.size())
+            return nullptr;
+
+        const auto& ids = children[partition];
+
+        return child < 0 || static_cast <std::size_t>(child) >= ids.size() ?
+            nullptr : &ids[child];
+    }
+};
+
+/**
+ * @e Migration moves atomic models between the sub-coupled models of a
+ * root TGF file. The flattened graph of the original files is read once,
+ * a migration changes the partition of some vertices and @e write writes
+ * a new root TGF file and its sub-coupled TGF files in a directory: the
+ * connections are kept, a connection between two partitions goes through
+ * an output port of the source partition and an input port of the
+ * destination (the port is the vertex of the source, as in the examples).
+ */
+class Migration
+{
+public:
+    Migration(const std::string& rootfile)
+        : m_topology(topology_read(rootfile))
+        , m_root(tgf_read(rootfile).models)
+        , m_in(m_topology.vertices.size())
+    {
+        m_assignment.reserve(m_topology.vertices.size());
+
+        for (std::size_t v = 0, e = m_topology.vertices.size(); v != e; ++v) {
+            m_assignment.push_back(m_topology.vertices[v].partition);
+
+            for (int dst : m_topology.vertices[v].out)
+                m_in[dst].push_back(static_cast <int>(v));
+        }
+    }
+
+    const Topology& topology() const
+    {
+        return m_topology;
+    }
+
+    /** Connections between two partitions with the current assignment. */
+    std::size_t cut() const
+    {
+        std::size_t ret = 0;
+
+        for (std::size_t v = 0, e = m_topology.vertices.size(); v != e; ++v)
+            for (int dst : m_topology.vertices[v].out)
+                if (m_assignment[v] != m_assignment[dst])
+                    ret++;
+
+        return ret;
+    }
+
+    /** The partition of each vertex of the topology (-1 for the root). */
+    const std::vector <int>& assignment() const
+    {
+        return m_assignment;
+    }
+
+    /**
+     * Replace the assignment, e.g. by the one of @e repartition.
+     *
+     * @exception std::invalid_argument if @e assignment moves a model into
+     * or out of the root or names an unknown partition.
+     */
+    void assign(const std::vector <int>& assignment)
+    {
+        const int partitions = static_cast <int>(m_topology.partitions());
+
+        if (assignment.size() != m_assignment.size())
+            throw std::invalid_argument("Migration: bad assignment size");
+
+        for (std::size_t v = 0, e = assignment.size(); v != e; ++v)
+            if ((assignment[v] < 0) != (m_topology.vertices[v].partition < 0) ||
+                assignment[v] >= partitions)
+                throw std::invalid_argument("Migration: bad assignment");
+
+        m_assignment = assignment;
+    }
+
+    /** max / mean of @e load (0 if empty). */
+    static double imbalance(const std::vector <double>& load)
+    {
+        double sum = 0.0, max = 0.0;
+
+        for (double value : load) {
+            sum += value;
+            max = std::max(max, value);
+        }
+
+        return sum > 0.0 ? max / (sum / static_cast <double>(load.size())) :
+            0.0;
+    }
+
+    /**
+     * Move models from the most loaded partitions to the least loaded ones
+     * while the imbalance factor of @e load (the measured load of each
+     * partition, indexed as the partitions of the topology) is above the
+     * threshold of @e policy. The cost of a model is the mean cost of the
+     * models of its partition. The models moved from a partition are grown
+     * from its models connected to the destination, to keep the cut small.
+     * Returns the number of moved models.
+     */
+    std::size_t plan(const std::vector <double>& load,
+                     const MigrationPolicy& policy)
+    {
+        const std::size_t partitions = m_topology.partitions();
+
+        if (load.size() != partitions || partitions < 2)
+            return 0;
+
+        std::vector <double> estimate(load);
+        std::vector <std::size_t> size(partitions, 0);
+        std::vector <std::size_t> budget(partitions, 0);
+        std::vector <double> cost(partitions, 0.0);
+        std::vector <char> moved(m_assignment.size(), 0);
+        double mean = 0.0;
+        std::size_t ret = 0;
+
+        for (int partition : m_assignment)
+            if (partition >= 0)
+                size[partition]++;
+
+        for (std::size_t p = 0; p != partitions; ++p) {
+            mean += load[p];
+            cost[p] = size[p] ? load[p] / static_cast <double>(size[p]) : 0.0;
+            budget[p] = static_cast <std::size_t>(
+                policy.moves * static_cast <double>(size[p]));
+        }
+
+        mean /= static_cast <double>(partitions);
+
+        for (std::size_t i = 0; i != partitions; ++i) {
+            auto minmax = std::minmax_element(estimate.begin(), estimate.end());
+            int from = static_cast <int>(minmax.second - estimate.begin());
+            int to = static_cast <int>(minmax.first - estimate.begin());
+
+            if (mean <= 0.0 || estimate[from] <= policy.threshold * mean ||
+                cost[from] <= 0.0)
+                break;
+
+            double amount = std::min(estimate[from] - mean, mean - estimate[to]);
+            std::size_t nb = std::min(
+                static_cast <std::size_t>(amount / cost[from]),
+                std::min(budget[from], size[from] - 1));
+
+            if (nb == 0)
+                break;
+
+            nb = move(from, to, nb, moved);
+
+            if (nb == 0)
+                break;
+
+            size[from] -= nb;
+            size[to] += nb;
+            budget[from] -= nb;
+            estimate[from] -= cost[from] * static_cast <double>(nb);
+            estimate[to] += cost[from] * static_cast <double>(nb);
+            ret += nb;
+        }
+
+        return ret;
+    }
+
+    /**
+     * Write the root TGF file `root.tgf' and the sub-coupled TGF files
+     * `S%d.tgf' of the current assignment into @e directory (with a
+     * trailing `/') and returns the identity of their models.
+     *
+     * @exception std::runtime_error if a file can not be written.
+     */
+    std::shared_ptr <const ModelOrigin> write(const std::string& directory) const
+    {
+        const std::size_t size = m_topology.vertices.size();
+        const std::size_t partitions = m_topology.partitions();
+        auto origin = std::make_shared <ModelOrigin>();
+        std::vector <std::vector <int>> members(partitions);
+        std::vector <int> local(size, 0);
+        std::vector <std::vector <TGF::Edge>> edges(partitions);
+        std::vector <TGF::Edge> root;
+        std::vector <char> output(size, 0);
+        std::vector <int> seen;
+
+        origin->names.reserve(m_root.size());
+        for (std::size_t i = 0, e = m_root.size(); i != e; ++i)
+            origin->names.push_back("S" + std::to_string(i));
+        origin->children.resize(m_root.size());
+
+        for (std::size_t v = 0; v != size; ++v) {
+            int partition = m_assignment[v];
+            if (partition < 0)
+                continue;
+
+            const Topology::Vertex& vertex = m_topology.vertices[v];
+
+            members[partition].push_back(static_cast <int>(v));
+            local[v] = static_cast <int>(members[partition].size());
+            origin->children[m_topology.children[partition]].push_back(
+                ModelOrigin::Identity{m_topology.children[vertex.partition],
+                                      vertex.id});
+        }
+
+        for (std::size_t u = 0; u != size; ++u) {
+            int from = m_assignment[u];
+            int source = vertex(static_cast <int>(u));
+            int port = static_cast <int>(u);
+
+            seen.clear();
+
+            for (int v : m_topology.vertices[u].out) {
+                int to = m_assignment[v];
+                int destination = vertex(v);
+
+                if (from >= 0 && from == to) {
+                    edges[from].push_back(TGF::Edge{local[u], local[v], 0, 0});
+                    continue;
+                }
+
+                if (from < 0 && to < 0) {
+                    root.push_back(TGF::Edge{source, destination, 0, 0});
+                    continue;
+                }
+
+                if (from >= 0 && !output[u]) {
+                    edges[from].push_back(TGF::Edge{local[u], 0, 0, port});
+                    output[u] = 1;
+                }
+
+                if (to < 0) {
+                    root.push_back(TGF::Edge{source, destination, port, 0});
+                    continue;
+                }
+
+                edges[to].push_back(TGF::Edge{0, local[v], port, 0});
+
+                if (std::find(seen.begin(), seen.end(), to) == seen.end()) {
+                    root.push_back(TGF::Edge{source, destination,
+                                             from >= 0 ? port : 0, port});
+                    seen.push_back(to);
+                }
+            }
+        }
+
+        std::vector <std::string> types;
+
+        write_file(directory + "root.tgf", m_root, root);
+
+        for (std::size_t p = 0; p != partitions; ++p) {
+            types.clear();
+            for (int v : members[p])
+                types.push_back(m_topology.vertices[v].type);
+
+            write_file(directory + "S" + std::to_string(
+                           m_topology.children[p]) + ".tgf", types, edges[p]);
+        }
+
+        return origin;
+    }
+
+    /** Remove the files of @e write from @e directory. */
+    void remove(const std::string& directory) const
+    {
+        std::remove((directory + "root.tgf").c_str());
+
+        for (int child : m_topology.children)
+            std::remove((directory + "S" + std::to_string(child) +
+                         ".tgf").c_str());
+    }
+
+private:
+    /** The vertex of @e v in the root TGF file (1 for the first model). */
+    int vertex(int v) const
+    {
+        int partition = m_assignment[v];
+
+        return 1 + (partition >= 0 ? m_topology.children[partition] :
+                    m_topology.vertices[v].id);
+    }
+
+    /** Move @e nb models of @e from to @e to, returns the number moved. */
+    std::size_t move(int from, int to, std::size_t nb, std::vector <char>& moved)
+    {
+        const std::size_t size = m_assignment.size();
+        std::vector <char> queued(size, 0);
+        std::deque <int> queue;
+        std::size_t next = size;
+        std::size_t ret = 0;
+
+        auto neighbours = [this](int v, int partition)
+            {
+                for (int w : m_topology.vertices[v].out)
+                    if (m_assignment[w] == partition)
+                        return true;
+                for (int w : m_in[v])
+                    if (m_assignment[w] == partition)
+                        return true;
+
+                return false;
+            };
+
+        for (std::size_t v = 0; v != size; ++v) {
+            if (m_assignment[v] == from && !moved[v] &&
+                neighbours(static_cast <int>(v), to)) {
+                queue.push_back(static_cast <int>(v));
+                queued[v] = 1;
+            }
+        }
+
+        while (ret < nb) {
+            if (queue.empty()) {
+                while (next > 0 && (m_assignment[next - 1] != from ||
+                                    moved[next - 1] || queued[next - 1]))
+                    --next;
+
+                if (next == 0)
+                    break;
+
+                queue.push_back(static_cast <int>(--next));
+                queued[next] = 1;
+            }
+
+            int v = queue.front();
+            queue.pop_front();
+
+            if (m_assignment[v] != from)
+                continue;
+
+            m_assignment[v] = to;
+            moved[v] = 1;
+            ret++;
+
+            auto push = [&](int w)
+                {
+                    if (m_assignment[w] == from && !moved[w] && !queued[w]) {
+                        queue.push_back(w);
+                        queued[w] = 1;
+                    }
+                };
+
+            for (int w : m_topology.vertices[v].out)
+                push(w);
+            for (int w : m_in[v])
+                push(w);
+        }
+
+        return ret;
+    }
+
+    static void write_file(const std::string& filename,
+                           const std::vector <std::string>& models,
+                           const std::vector <TGF::Edge>& edges)
+    {
+        FILE *file = std::fopen(filename.c_str(), "w");
+        if (!file)
+            throw std::runtime_error(std::string("Migration: failed to write ")
+                                     + filename);
+
+        for (const auto& model : models)
+            std::fprintf(file, "%s\n", model.c_str());
+
+        std::fputs("#\n", file);
+
+        for (const auto& edge : edges)
+            std::fprintf(file, "%d %d %d %d\n", edge.src, edge.dst,
+                         edge.src_port, edge.dst_port);
+
+        if (std::fclose(file) != 0)
+            throw std::runtime_error(std::string("Migration: failed to write ")
+                                     + filename);
+    }
+
+    Topology m_topology;
+    std::vector <std::string> m_root;
+    std::vector <std::vector <int>> m_in;
+    std::vector <int> m_assignment;
+};
+
+}
+
+#endif
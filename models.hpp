@@ -28,22 +28,165 @@
 #define __Benchmark_models_hpp__
 
 #include "linpackc.hpp"
+#include "activity.hpp"
+#include "arena.hpp"
+#include "critical-path.hpp"
 #include "defs.hpp"
+#include "memory.hpp"
+#include "migration.hpp"
+#include "parameters.hpp"
+#include "profiler.hpp"
+#include "stats.hpp"
+#include "timer.hpp"
+#include "trace.hpp"
 #include <vle/mpi-synchronous.hpp>
 #include <vle/utils.hpp>
+#include <atomic>
 #include <fstream>
 #include <numeric>
+#include <unordered_map>
 
 namespace bench {
 
-struct TopPixel : AtomicModel
+/**
+ * Get the @e CostRecorder slot of the model @e name if the cost recording
+ * is activated (the `cost-recorder' parameter), nullptr otherwise.
+ */
+inline std::vector <double>* cost_recorder_slot(const vle::Common& common,
+                                                const std::string& name)
+{
+    auto it = common.find("cost-recorder");
+    if (it == common.end())
+        return nullptr;
+
+    return boost::any_cast <std::shared_ptr <CostRecorder>>(it->second)
+        ->slot(name);
+}
+
+/**
+ * Get the @e MemoryProbe of the run if the allocation accounting is
+ * activated (the `memory-probe' parameter), nullptr otherwise.
+ */
+inline MemoryProbe* memory_probe(const vle::Common& common)
+{
+    auto it = common.find("memory-probe");
+    if (it == common.end())
+        return nullptr;
+
+    return boost::any_cast <std::shared_ptr <MemoryProbe>>(it->second).get();
+}
+
+/**
+ * Get the @e StatsSegment of the run (the `stats-segment' parameter),
+ * nullptr if the events are not counted.
+ */
+inline StatsSegment* stats_segment(const vle::Common& common)
+{
+    auto it = common.find("stats-segment");
+    if (it == common.end())
+        return nullptr;
+
+    return boost::any_cast <std::shared_ptr <StatsSegment>>(it->second).get();
+}
+
+/**
+ * @e ModelWorkload is the cost of the transitions of an atomic model: the
+ * cost given by the sub-coupled model or, with a per transition
+ * @e CostDistribution (the `cost-distribution' parameter), a new cost
+ * drawn at each transition or, if the model is in the replayed @e Trace
+ * (the `trace' parameter), the recorded cost of the step (the k-th
+ * transition of the model replays the step k). The costs are added to the
+ * work of the partition if the workload is reported. The transitions are
+ * timed into the load slot of the partition if the load is reported.
+ */
+struct ModelWorkload
+{
+    double duration = 0.0;
+    const CostDistribution *distribution = nullptr;
+    std::uint64_t state = 0;
+    int partition = 0;
+    WorkloadStats::Slot *work = nullptr;
+    LoadStats::Slot *load = nullptr;
+    TraceCursor trace;
+    std::uint32_t step = 0;
+
+    void init(const ParameterView& params, int id)
+    {
+        duration = params.cost();
+        partition = params.partition();
+        work = params.work();
+        load = params.load();
+        distribution = nullptr;
+        trace = TraceCursor();
+        step = 0;
+
+        auto found = params.parent().find("trace");
+        if (found != params.parent().end()) {
+            auto range = boost::any_cast <std::shared_ptr <const Trace>>(
+                found->second)->find(partition, id);
+
+            if (range.first != range.second) {
+                trace.next = range.first;
+                trace.end = range.second;
+            }
+        }
+
+        if (work)
+            work->models.fetch_add(1, std::memory_order_relaxed);
+
+        auto it = params.parent().find("cost-distribution");
+        if (it != params.parent().end()) {
+            auto ptr = boost::any_cast <std::shared_ptr <const CostDistribution>>(
+                it->second).get();
+
+            if (ptr->per_transition) {
+                distribution = ptr;
+                state = ptr->state(partition, id);
+            }
+        }
+    }
+
+    /** The busy counter of the partition, null if not reported. */
+    std::atomic <std::uint64_t>* busy() const
+    {
+        return load ? &load->busy : nullptr;
+    }
+
+    void run()
+    {
+        double cost;
+
+        if (!trace.empty())
+            cost = trace.cost(step++);
+        else if (distribution)
+            cost = distribution->draw(state, partition);
+        else
+            cost = duration;
+
+        if (work)
+            work->add(cost);
+
+        if (cost > 0)
+            bench::work(cost);
+    }
+};
+
+struct TopPixel : AtomicModel, ArenaAllocated <TopPixel>
 {
     int m_id;
     std::string m_name;
-    long int m_duration;
+    ModelWorkload m_workload;
+    std::vector <double> *m_costs;
+    double m_pending_cost;
+    MemoryProbe *m_memory;
+    StatsSegment *m_stats;
 
     TopPixel(const vle::Context& ctx)
         : AtomicModel(ctx, {}, {"0"})
+        , m_costs(nullptr)
+        , m_pending_cost(0.0)
+        , m_memory(nullptr)
+        , m_stats(nullptr)
     {}
 
     virtual ~TopPixel()
@@ -51,22 +194,43 @@ struct TopPixel : AtomicModel
 
     virtual double init(const vle::Common& common, const double&) override final
     {
+        ProfileRegion region("model-init");
+        ParameterView params(common);
+        std::string name;
+
         try {
-            m_id = boost::any_cast <int>(common.at("id"));
-            m_name = std::string("top-") + boost::any_cast <std::string>(common.at("name"));
-            m_duration = boost::any_cast <long int>(common.at("duration"));
+            m_id = params.id();
+            name = params.name();
+            m_name = std::string("top-") + name;
+            m_workload.init(params, m_id);
         } catch (const std::exception &e) {
             throw std::invalid_argument("TopPixel: failed to find name "
                                         "or duration parameters");
         }
 
+        m_costs = cost_recorder_slot(params.parent(), name);
+        m_pending_cost = 0.0;
+        m_memory = memory_probe(params.parent());
+        if (m_memory)
+            m_memory->init();
+        m_stats = stats_segment(params.parent());
+
         return 0.0;
     }
 
     virtual double delta(const double&) override final
     {
-        if (m_duration > 0)
-            bench::sleep_and_work(m_duration);
+        LoadProbe load(m_workload.busy());
+        CostProbe probe(m_costs, &m_pending_cost);
+        probe.fire();
+
+        if (m_memory)
+            m_memory->transition();
+
+        if (m_stats)
+            m_stats->transition(0);
+
+        m_workload.run();
 
         return 1.0;
     }
@@ -79,7 +243,7 @@ struct TopPixel : AtomicModel
     }
 };
 
-struct NormalPixel : AtomicModel
+struct NormalPixel : AtomicModel, ArenaAllocated <NormalPixel>
 {
     enum Phase { WAIT, SEND };
 
@@ -87,12 +251,16 @@ struct NormalPixel : AtomicModel
     std::string  m_name;
     double       m_current_time;
     double       m_last_time;
-    long int     m_duration;
+    ModelWorkload m_workload;
     unsigned int m_neighbour_number;
     unsigned int m_received;
     unsigned int m_total_received;
     Phase        m_phase;
     double       m_simulation_duration;
+    std::vector <double> *m_costs;
+    double       m_pending_cost;
+    MemoryProbe *m_memory;
+    StatsSegment *m_stats;
 
     NormalPixel(const vle::Context& ctx)
         : AtomicModel(ctx, {"0"}, {"0"})
@@ -102,6 +270,10 @@ struct NormalPixel : AtomicModel
         , m_received(0)
         , m_total_received(0)
         , m_phase(WAIT)
+        , m_costs(nullptr)
+        , m_pending_cost(0.0)
+        , m_memory(nullptr)
+        , m_stats(nullptr)
     {
         try {
             m_simulation_duration = boost::any_cast <double>(ctx->get_user_data());
@@ -129,16 +301,19 @@ struct NormalPixel : AtomicModel
     virtual double init(const vle::Common& common,
                         const double& t) override final
     {
+        ProfileRegion region("model-init");
         m_current_time = t;
         m_last_time = Infinity <double>::negative;
 
+        ParameterView params(common);
+        std::string name;
+
         try {
-            m_id = boost::any_cast <int>(common.at("id"));
-            m_duration = boost::any_cast <long int>(common.at("duration"));
-            m_name = std::string("normal-") +
-                boost::any_cast <std::string>(common.at("name"));
-            m_neighbour_number =
-                boost::any_cast <unsigned int>(common.at("neighbour_number"));
+            m_id = params.id();
+            m_workload.init(params, m_id);
+            name = params.name();
+            m_name = std::string("normal-") + name;
+            m_neighbour_number = params.neighbour_number();
         } catch (const std::exception &e) {
             throw std::invalid_argument("NormalPixel: failed to find duration,"
                                         "name or neighbour_number parameters");
@@ -147,18 +322,37 @@ struct NormalPixel : AtomicModel
         m_received = 0;
         m_total_received = 0;
         m_phase = WAIT;
+        m_costs = cost_recorder_slot(params.parent(), name);
+        m_pending_cost = 0.0;
+        m_memory = memory_probe(params.parent());
+        if (m_memory)
+            m_memory->init();
+        m_stats = stats_segment(params.parent());
 
         return Infinity <double>::positive;
     }
 
     virtual double delta(const double& time) override final
     {
+        LoadProbe load(m_workload.busy());
+        CostProbe probe(m_costs, &m_pending_cost);
+
+        if (m_memory)
+            m_memory->transition();
+
         m_current_time += time;
 
-        if (x.empty())
+        if (x.empty()) {
             dint(m_current_time);
-        else
+            probe.fire();
+        } else {
             dext(m_current_time);
+        }
+
+        if (m_stats) {
+            m_stats->transition(x.empty() ? 0u : x[0].size());
+            m_stats->advance(m_current_time);
+        }
 
         if (m_phase == WAIT)
             return Infinity <double>::positive;
@@ -170,8 +364,7 @@ struct NormalPixel : AtomicModel
     {
         vle_dbg(context(), "[%s] dint at %f\n", m_name.c_str(), time);
 
-        if (m_duration > 0)
-            bench::sleep_and_work(m_duration);
+        m_workload.run();
 
         if (m_phase == SEND) {
             vle_dbg(context(), "[%s] %" PRIuMAX "-%" PRIuMAX
@@ -220,22 +413,337 @@ struct NormalPixel : AtomicModel
     }
 };
 
+/**
+ * Get the @e Activity of the sparse models (the `activity' parameter), the
+ * defaults if not set.
+ */
+inline const Activity& activity_parameter(const vle::Common& common)
+{
+    static const Activity defaults;
+
+    auto it = common.find("activity");
+    if (it == common.end())
+        return defaults;
+
+    return *boost::any_cast <std::shared_ptr <const Activity>>(it->second);
+}
+
+/**
+ * @e ActivityPixel is the base of the sparse atomic models: unlike the
+ * pixels, they fire on their own schedule (the time advance returned by
+ * @e advance) whatever they receive. The messages received are only
+ * counted, so sparse models can be connected in any graph, but not to the
+ * normal pixels that expect one message per neighbour and per step.
+ */
+struct ActivityPixel : AtomicModel
+{
+    int m_id;
+    std::string m_name;
+    ModelWorkload m_workload;
+    const Activity *m_activity;
+    std::uint64_t m_state;
+    double m_time;
+    double m_next;
+    std::uint64_t m_received;
+    std::vector <double> *m_costs;
+    double m_pending_cost;
+    MemoryProbe *m_memory;
+    StatsSegment *m_stats;
+
+    ActivityPixel(const vle::Context& ctx)
+        : AtomicModel(ctx, {"0"}, {"0"})
+        , m_activity(nullptr)
+        , m_state(0)
+        , m_time(0.0)
+        , m_next(0.0)
+        , m_received(0)
+        , m_costs(nullptr)
+        , m_pending_cost(0.0)
+        , m_memory(nullptr)
+        , m_stats(nullptr)
+    {}
+
+    virtual ~ActivityPixel()
+    {}
+
+    /** Time to the next internal transition. */
+    virtual double advance() = 0;
+
+    virtual double init(const vle::Common& common,
+                        const double& t) override final
+    {
+        ProfileRegion region("model-init");
+        ParameterView params(common);
+        std::string name;
+        int partition;
+
+        try {
+            m_id = params.id();
+            name = params.name();
+            partition = params.partition();
+            m_name = std::string("activity-") + name;
+            m_workload.init(params, m_id);
+        } catch (const std::exception &e) {
+            throw std::invalid_argument("ActivityPixel: failed to find name "
+                                        "or duration parameters");
+        }
+
+        m_activity = &activity_parameter(params.parent());
+        m_state = random_seed(m_activity->seed, partition, m_id);
+        m_received = 0;
+        m_costs = cost_recorder_slot(params.parent(), name);
+        m_pending_cost = 0.0;
+        m_memory = memory_probe(params.parent());
+        if (m_memory)
+            m_memory->init();
+        m_stats = stats_segment(params.parent());
+
+        m_time = t;
+        m_next = t + start();
+
+        return m_next - m_time;
+    }
+
+    virtual double delta(const double& time) override final
+    {
+        LoadProbe load(m_workload.busy());
+        CostProbe probe(m_costs, &m_pending_cost);
+        std::size_t messages = x.empty() ? 0u : x[0].size();
+
+        m_time += time;
+        m_received += messages;
+
+        if (m_memory)
+            m_memory->transition();
+
+        if (m_stats) {
+            m_stats->transition(messages);
+            m_stats->advance(m_time);
+        }
+
+        /* The elapsed time is the difference of two dates: compare with a
+         * relative tolerance. */
+        if (m_next - m_time <= 1e-9 * std::max(1.0, std::abs(m_next))) {
+            probe.fire();
+            m_workload.run();
+            m_time = m_next;
+            m_next += advance();
+        }
+
+        return m_next - m_time;
+    }
+
+    virtual void lambda() const override final
+    {
+        vle_dbg(context(), "[%s] lambda\n", m_name.c_str());
+
+        y[0] = {m_id};
+    }
+
+protected:
+    /** Time to the first internal transition. */
+    virtual double start()
+    {
+        return advance();
+    }
+};
+
+/** Fires at each multiple of the unit with the probability of the ratio. */
+struct StochasticPixel : ActivityPixel, ArenaAllocated <StochasticPixel>
+{
+    StochasticPixel(const vle::Context& ctx)
+        : ActivityPixel(ctx)
+    {}
+
+    virtual double advance() override final
+    {
+        return m_activity->stochastic(m_state);
+    }
+};
+
+/** Fires every period, one of the co-prime periods chosen by model. */
+struct PeriodicPixel : ActivityPixel, ArenaAllocated <PeriodicPixel>
+{
+    double m_period;
+
+    PeriodicPixel(const vle::Context& ctx)
+        : ActivityPixel(ctx)
+        , m_period(1.0)
+    {}
+
+    virtual double advance() override final
+    {
+        return m_period;
+    }
+
+protected:
+    virtual double start() override final
+    {
+        m_period = m_activity->period(m_state);
+
+        return m_period;
+    }
+};
+
+/** Fires by bursts separated by exponential gaps. */
+struct BurstyPixel : ActivityPixel, ArenaAllocated <BurstyPixel>
+{
+    unsigned int m_left;
+
+    BurstyPixel(const vle::Context& ctx)
+        : ActivityPixel(ctx)
+        , m_left(0)
+    {}
+
+    virtual double advance() override final
+    {
+        return m_activity->bursty(m_state, m_left);
+    }
+
+protected:
+    virtual double start() override final
+    {
+        m_left = 0;
+
+        return advance();
+    }
+};
+
+/**
+ * @e Prebuildable is a model that can be initialized (i.e. built from its
+ * TGF file) before the Echll's call to @e init, for example by the separate
+ * construction of the @e Root children.
+ */
+struct Prebuildable
+{
+    virtual ~Prebuildable()
+    {}
+
+    virtual void prebuild(const vle::Common& common, const double& t) = 0;
+};
+
 template <typename T>
-struct Coupled : T
+struct Coupled : T, Prebuildable
 {
     std::string m_name;
+    ArenaSet m_arenas;
+    std::shared_ptr <const vle::Common> m_parameters;
+    std::unordered_map <const void*, unsigned int> m_neighbours;
+    const CostDistribution *m_distribution;
+    const ModelOrigin *m_origin;
+    WorkloadStats::Slot *m_work;
+    LoadStats::Slot *m_load;
+    int m_partition;
+    bool m_copy_common;
+    bool m_prebuilt;
+    double m_prebuilt_time;
 
     Coupled(const vle::Context& ctx)
         : T(ctx)
+        , m_distribution(nullptr)
+        , m_origin(nullptr)
+        , m_work(nullptr)
+        , m_load(nullptr)
+        , m_partition(0)
+        , m_copy_common(false)
+        , m_prebuilt(false)
+        , m_prebuilt_time(0.0)
     {}
 
     Coupled(const vle::Context& ctx, unsigned thread_number)
         : T(ctx, thread_number)
+        , m_distribution(nullptr)
+        , m_origin(nullptr)
+        , m_work(nullptr)
+        , m_load(nullptr)
+        , m_partition(0)
+        , m_copy_common(false)
+        , m_prebuilt(false)
+        , m_prebuilt_time(0.0)
     {}
 
     virtual ~Coupled()
     {}
 
+    /**
+     * Children are built from the TGF file during the initialization. If
+     * the `model-arena' parameter is true, the factory allocates them from
+     * the arenas of this coupled model.
+     */
+    virtual double init(const vle::Common& common,
+                        const double& t) override
+    {
+        if (m_prebuilt) {
+            m_prebuilt = false;
+            return m_prebuilt_time;
+        }
+
+        ProfileRegion region("partition");
+        auto it = common.find("model-arena");
+        bool use_arena = it != common.end() && boost::any_cast <bool>(it->second);
+
+        ArenaScope scope(use_arena ? &m_arenas : nullptr);
+
+        it = common.find("common-copy");
+        m_copy_common = it != common.end() && boost::any_cast <bool>(it->second);
+
+        it = common.find("id");
+        m_partition = it == common.end() ? 0 : boost::any_cast <int>(it->second);
+
+        it = common.find("cost-distribution");
+        m_distribution = it == common.end() ? nullptr :
+            boost::any_cast <std::shared_ptr <const CostDistribution>>(
+                it->second).get();
+
+        it = common.find("model-origin");
+        m_origin = it == common.end() ? nullptr :
+            boost::any_cast <std::shared_ptr <const ModelOrigin>>(
+                it->second).get();
+
+        it = common.find("workload");
+        m_work = it == common.end() ? nullptr :
+            boost::any_cast <std::shared_ptr <WorkloadStats>>(it->second)
+            ->slot(m_partition);
+
+        it = common.find("partition-load");
+        m_load = it == common.end() ? nullptr :
+            boost::any_cast <std::shared_ptr <LoadStats>>(it->second)
+            ->slot(m_partition);
+        m_parameters.reset();
+        m_neighbours.clear();
+
+        double ret = T::init(common, t);
+
+        m_parameters.reset();
+        m_neighbours.clear();
+
+        return ret;
+    }
+
+    virtual void prebuild(const vle::Common& common,
+                          const double& t) override
+    {
+        m_prebuilt = false;
+        m_prebuilt_time = init(common, t);
+        m_prebuilt = true;
+    }
+
+    /** The lambda and the delta are timed into the load slot of the
+     * partition if the load is reported. */
+    virtual void lambda() const override
+    {
+        LoadProbe load(m_load ? &m_load->partition : nullptr);
+
+        T::lambda();
+    }
+
+    virtual double delta(const double& t) override
+    {
+        LoadProbe load(m_load ? &m_load->partition : nullptr);
+
+        return T::delta(t);
+    }
+
     virtual void apply_common(const vle::Common& common) override
     {
         m_name = vle::common_get <std::string>(common, "name");
@@ -246,16 +754,16 @@ struct Coupled : T
                                       const typename Coupled::edges& e,
                                       int child) override
     {
-       auto mdl = v[child].get();
-
-        unsigned int nb = std::accumulate(
-            e.cbegin(), e.cend(),
-            0u, [&mdl](unsigned int x, const typename Coupled::edges::value_type& edge)
-            {
-                return edge.second.first == mdl ? x + 1u : x;
-            });
+        /* The input connections of all the children are counted in one
+         * pass over the edges at the first child. */
+        if (m_neighbours.empty()) {
+            for (const auto& edge : e)
+                m_neighbours[edge.second.first]++;
+        }
 
-        vle::Common ret(common);
+        auto mdl = v[child].get();
+        auto found = m_neighbours.find(mdl);
+        unsigned int nb = found == m_neighbours.end() ? 0u : found->second;
 
         vle_dbg(T::context(),
                 "[%s] init %s (%p) with %" PRIuMAX " neightbour\n",
@@ -264,9 +772,54 @@ struct Coupled : T
                 mdl,
                 static_cast <std::uintmax_t>(nb));
 
-        ret["id"] = child;
-        ret["name"] = vle::stringf("%s-%d", m_name.c_str(), child);
-        ret["neighbour_number"] = nb;
+        /* A migrated child keeps the identity of its original partition
+         * (see Migration). */
+        int partition = m_partition;
+        int id = child;
+        const std::string *name = &m_name;
+        if (m_origin) {
+            if (const ModelOrigin::Identity *identity =
+                m_origin->find(m_partition, child)) {
+                partition = identity->partition;
+                id = identity->id;
+                name = &m_origin->names[partition];
+            }
+        }
+
+        /* The cost of the child is drawn from its own seeded generator:
+         * it does not depend on the order of the children. */
+        double cost = -1.0;
+        if (m_distribution) {
+            std::uint64_t state = m_distribution->state(partition, id);
+            cost = m_distribution->draw(state, partition);
+        }
+
+        if (m_copy_common) {
+            vle::Common ret(common);
+
+            ret["id"] = id;
+            ret["name"] = vle::stringf("%s-%d", name->c_str(), id);
+            ret["neighbour_number"] = nb;
+            ret["partition"] = partition;
+            if (cost >= 0.0)
+                ret["cost"] = cost;
+            if (m_work)
+                ret["work-slot"] = m_work;
+            if (m_load)
+                ret["load-slot"] = m_load;
+
+            return std::move(ret);
+        }
+
+        /* Children share one immutable copy of the parameters of this
+         * coupled model. */
+        if (!m_parameters)
+            m_parameters = std::make_shared <const vle::Common>(common);
+
+        vle::Common ret;
+        ret.emplace("overlay", CommonOverlay(m_parameters, name, id, nb,
+                                             partition, cost, m_work,
+                                             m_load));
 
         return std::move(ret);
     }
@@ -317,17 +870,92 @@ struct RootMPI : T
 template <typename T>
 struct Root : T
 {
+    bool m_prebuild;
+    bool m_built;
+    double m_time;
+    double m_init_time;
+    double m_build_time;
+    double m_largest_build_time;
+    std::shared_ptr <LoadStats> m_load;
+    mutable std::uint64_t m_step_start;
+
     Root(const vle::Context& ctx, unsigned thread_number)
         : T(ctx, thread_number)
+        , m_prebuild(false)
+        , m_built(false)
+        , m_time(0.0)
+        , m_init_time(0.0)
+        , m_build_time(0.0)
+        , m_largest_build_time(0.0)
+        , m_step_start(0)
     {}
 
     virtual ~Root()
     {}
 
+    virtual double init(const vle::Common& common,
+                        const double& t) override
+    {
+        ProfileRegion region("init", &m_init_time);
+        auto it = common.find("prebuild");
+        m_prebuild = it != common.end() &&
+            boost::any_cast <bool>(it->second);
+        m_built = false;
+        m_time = t;
+
+        it = common.find("partition-load");
+        m_load = it == common.end() ? nullptr :
+            boost::any_cast <std::shared_ptr <LoadStats>>(it->second);
+        m_step_start = 0;
+
+        return T::init(common, t);
+    }
+
+    /**
+     * A step is the lambda and the delta of the root: if the load is
+     * reported, its duration closes the step of the partitions.
+     */
+    virtual void lambda() const override
+    {
+        if (m_load)
+            m_step_start = ProfileClock::now();
+
+        T::lambda();
+    }
+
+    virtual double delta(const double& t) override
+    {
+        if (!m_load)
+            return T::delta(t);
+
+        if (!m_step_start)
+            m_step_start = ProfileClock::now();
+
+        double ret = T::delta(t);
+
+        m_load->step(ProfileClock::now() - m_step_start);
+        m_step_start = 0;
+
+        return ret;
+    }
+
     virtual vle::Common update_common(const vle::Common& common,
                                       const typename Root::vertices& v,
                                       const typename Root::edges& e,
                                       int child) override
+    {
+        if (m_prebuild && !m_built) {
+            m_built = true;
+            build(common, v, e);
+        }
+
+        return child_common(common, v, e, child);
+    }
+
+    vle::Common child_common(const vle::Common& common,
+                             const typename Root::vertices& v,
+                             const typename Root::edges& e,
+                             int child) const
     {
         vle::Common ret(common);
 
@@ -342,11 +970,53 @@ struct Root : T
         ret["id"] = child;
         ret["name"] = vle::stringf("S%d", child);
         ret["neighbour_number"] = nb;
-        ret["tgf-filesource"] = vle::stringf("S%d.tgf", child);
+        ret["tgf-filesource"] = directory(common) +
+            vle::stringf("S%d.tgf", child);
         ret["tgf-format"] = (int)1;
 
         return std::move(ret);
     }
+
+    /** The directory of the sub-coupled TGF files (the `tgf-directory'
+     * parameter of the migrated files), the current one by default. */
+    static std::string directory(const vle::Common& common)
+    {
+        auto it = common.find("tgf-directory");
+
+        return it == common.end() ? std::string() :
+            boost::any_cast <std::string>(it->second);
+    }
+
+    /**
+     * Build all the sub-coupled models at the first @e update_common, one
+     * after another, and time each of them: the largest one is the bound of
+     * a parallel construction. The calls into Echll (the TGF loader, the
+     * factory and the connections) are not known to be thread-safe, so the
+     * construction is not parallelized. The following Echll's calls to
+     * @e init return the prebuilt results.
+     */
+    void build(const vle::Common& common,
+               const typename Root::vertices& v,
+               const typename Root::edges& e)
+    {
+        bench::Timer timer(&m_build_time);
+
+        m_largest_build_time = 0.0;
+        for (std::size_t i = 0; i != v.size(); ++i) {
+            Prebuildable *mdl = dynamic_cast <Prebuildable*>(v[i].get());
+            if (!mdl)
+                continue;
+
+            double time = 0.0;
+            {
+                bench::Timer partition(&time);
+                mdl->prebuild(child_common(common, v, e, static_cast <int>(i)),
+                              m_time);
+            }
+
+            m_largest_build_time = std::max(m_largest_build_time, time);
+        }
+    }
 };
 
 using RootThread = Root <GenericCoupledModelThread>;
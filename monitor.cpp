@@ -0,0 +1,141 @@
+/*
+ * Copyright (C) 2014 INRA
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "stats.hpp"
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <unistd.h>
+
+static void monitor_help() noexcept
+{
+    std::fprintf(stdout, "echll-benchmark-monitor [-h][-i interval] pid|name\n\n"
+                 "Options:\n"
+                 "  -h          This help message.\n"
+                 "  -i interval The polling interval in milliseconds\n"
+                 "              (default 1000).\n"
+                 "  pid|name    The process identifier of an Echll-benchmark\n"
+                 "              started with -w or the name of its segment.\n\n"
+                 "Prints, at each interval:\n"
+                 "  elapsed;file;replicate;replicates;time;steps;"
+                 "transitions/s;messages/s;steps/s;state\n"
+                 "where state is running, stalled (no transition during the\n"
+                 "interval) or finished.\n");
+}
+
+int main(int argc, char *argv[])
+{
+    long int interval = 1000;
+    int opt;
+
+    while ((opt = ::getopt(argc, argv, "hi:")) != -1) {
+        switch (opt) {
+        case 'h':
+            monitor_help();
+            return EXIT_SUCCESS;
+        case 'i':
+            interval = std::strtol(::optarg, nullptr, 10);
+            if (interval <= 0) {
+                std::fprintf(stderr, "Bad interval %s\n", ::optarg);
+                return EXIT_FAILURE;
+            }
+            break;
+        default:
+            monitor_help();
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (::optind >= argc) {
+        monitor_help();
+        return EXIT_FAILURE;
+    }
+
+    std::string name(argv[::optind]);
+    if (name[0] != '/')
+        name = bench::stats_name(std::strtol(name.c_str(), nullptr, 10));
+
+    auto segment = bench::stats_attach(name);
+    if (!segment) {
+        std::fprintf(stderr, "Failed to attach the segment %s\n",
+                     name.c_str());
+        return EXIT_FAILURE;
+    }
+
+    std::uint64_t start = bench::stats_now();
+    std::uint64_t last = start;
+    std::uint64_t transitions = segment->transitions();
+    std::uint64_t messages = segment->messages();
+    std::uint64_t steps = segment->steps.load();
+    std::uint64_t replicate = segment->replicate.load();
+
+    for (;;) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(interval));
+
+        std::uint64_t now = bench::stats_now();
+        std::uint64_t state = segment->state.load();
+        std::uint64_t new_transitions = segment->transitions();
+        std::uint64_t new_messages = segment->messages();
+        std::uint64_t new_steps = segment->steps.load();
+        std::uint64_t new_replicate = segment->replicate.load();
+        double seconds = static_cast <double>(now - last) / 1e9;
+
+        /* The steps restart at each replicate. */
+        if (new_replicate != replicate || new_steps < steps)
+            steps = 0;
+
+        const char *state_name = "running";
+        if (state == bench::StatsSegment::FINISHED)
+            state_name = "finished";
+        else if (new_transitions == transitions)
+            state_name = "stalled";
+
+        std::fprintf(stdout, "%f;%" PRIu64 ";%" PRIu64 ";%" PRIu64
+                     ";%f;%" PRIu64 ";%f;%f;%f;%s\n",
+                     static_cast <double>(now - start) / 1e6,
+                     segment->file.load(), new_replicate,
+                     segment->replicates.load(), segment->simulated_time(),
+                     new_steps,
+                     static_cast <double>(new_transitions - transitions) / seconds,
+                     static_cast <double>(new_messages - messages) / seconds,
+                     static_cast <double>(new_steps - steps) / seconds,
+                     state_name);
+        std::fflush(stdout);
+
+        if (state == bench::StatsSegment::FINISHED)
+            break;
+
+        last = now;
+        transitions = new_transitions;
+        messages = new_messages;
+        steps = new_steps;
+        replicate = new_replicate;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,184 @@
+/*
+ * Copyright (C) 2014 INRA
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __Benchmark_parameters_hpp__
+#define __Benchmark_parameters_hpp__
+
+#include <vle/common.hpp>
+#include <boost/any.hpp>
+#include "imbalance.hpp"
+#include "workload.hpp"
+#include <memory>
+#include <string>
+
+namespace bench {
+
+/**
+ * @e CommonOverlay is the per child parameter of a sub-coupled model: the
+ * typed fields of the child over an immutable copy of the parameters of
+ * the coupled model, shared by all its children. It replaces the copy of
+ * the whole @e vle::Common map for each child.
+ */
+struct CommonOverlay
+{
+    CommonOverlay(std::shared_ptr <const vle::Common> parent,
+                  const std::string *coupled_name,
+                  int id,
+                  unsigned int neighbour_number,
+                  int partition,
+                  double cost,
+                  WorkloadStats::Slot *work,
+                  LoadStats::Slot *load)
+        : parent(std::move(parent))
+        , coupled_name(coupled_name)
+        , id(id)
+        , neighbour_number(neighbour_number)
+        , partition(partition)
+        , cost(cost)
+        , work(work)
+        , load(load)
+    {}
+
+    std::shared_ptr <const vle::Common> parent;
+    const std::string *coupled_name;
+    int id;
+    unsigned int neighbour_number;
+    int partition;
+    double cost;                /* < 0: the `duration' parameter. */
+    WorkloadStats::Slot *work;
+    LoadStats::Slot *load;
+};
+
+/**
+ * @e ParameterView reads the parameters of an atomic model from either a
+ * @e CommonOverlay (the `overlay' parameter) or a plain @e vle::Common with
+ * the `id', `name', `neighbour_number', `partition', `cost',
+ * `work-slot' and `load-slot' parameters (the last four are optional).
+ */
+class ParameterView
+{
+public:
+    ParameterView(const vle::Common& common)
+        : m_common(&common)
+        , m_overlay(nullptr)
+    {
+        auto it = common.find("overlay");
+        if (it != common.end()) {
+            m_overlay = boost::any_cast <CommonOverlay>(&it->second);
+            m_common = m_overlay->parent.get();
+        }
+    }
+
+    /** The parameters shared with the coupled model. */
+    const vle::Common& parent() const
+    {
+        return *m_common;
+    }
+
+    int id() const
+    {
+        if (m_overlay)
+            return m_overlay->id;
+
+        return boost::any_cast <int>(m_common->at("id"));
+    }
+
+    std::string name() const
+    {
+        if (m_overlay)
+            return *m_overlay->coupled_name + '-' +
+                std::to_string(m_overlay->id);
+
+        return boost::any_cast <std::string>(m_common->at("name"));
+    }
+
+    unsigned int neighbour_number() const
+    {
+        if (m_overlay)
+            return m_overlay->neighbour_number;
+
+        return boost::any_cast <unsigned int>(m_common->at("neighbour_number"));
+    }
+
+    int partition() const
+    {
+        if (m_overlay)
+            return m_overlay->partition;
+
+        auto it = m_common->find("partition");
+
+        return it == m_common->end() ? 0 : boost::any_cast <int>(it->second);
+    }
+
+    /** The cost of the transitions of the model in milliseconds. */
+    double cost() const
+    {
+        if (m_overlay && m_overlay->cost >= 0.0)
+            return m_overlay->cost;
+
+        auto it = m_common->find("cost");
+        if (it != m_common->end())
+            return boost::any_cast <double>(it->second);
+
+        return boost::any_cast <double>(m_common->at("duration"));
+    }
+
+    WorkloadStats::Slot* work() const
+    {
+        if (m_overlay)
+            return m_overlay->work;
+
+        auto it = m_common->find("work-slot");
+
+        return it == m_common->end() ? nullptr :
+            boost::any_cast <WorkloadStats::Slot*>(it->second);
+    }
+
+    LoadStats::Slot* load() const
+    {
+        if (m_overlay)
+            return m_overlay->load;
+
+        auto it = m_common->find("load-slot");
+
+        return it == m_common->end() ? nullptr :
+            boost::any_cast <LoadStats::Slot*>(it->second);
+    }
+
+    template <typename T>
+    T get(const std::string& key) const
+    {
+        return boost::any_cast <T>(m_common->at(key));
+    }
+
+private:
+    const vle::Common *m_common;
+    const CommonOverlay *m_overlay;
+};
+
+}
+
+#endif
@@ -0,0 +1,241 @@
+/*
+ * Copyright (C) 2014 INRA
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __Benchmark_perf_hpp__
+#define __Benchmark_perf_hpp__
+
+#include <cstdint>
+#include <cstring>
+
+#ifdef HAVE_LINUX_PERF_EVENT_H
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace bench {
+
+/**
+ * @e PerfCounters opens a set of hardware and software counters with the
+ * Linux perf_event_open(2) syscall for the calling thread. Counters are
+ * inherited by the threads created while they are enabled, so the worker
+ * threads of @e TransitionPolicyThread and the linpack threads started
+ * in the timed region are included.
+ *
+ * A counter that can not be opened (no PMU in a virtual machine, or a
+ * restrictive /proc/sys/kernel/perf_event_paranoid) is simply marked as
+ * unavailable and reported as -1.
+ */
+struct PerfCounters
+{
+    enum Counter { CYCLES, INSTRUCTIONS, LLC_MISSES, BRANCH_MISSES,
+                   CONTEXT_SWITCHES, CPU_MIGRATIONS, COUNTER_NUMBER };
+
+    static const char* name(int counter)
+    {
+        static const char *names[] = { "cycles", "instructions",
+                                       "llc-misses", "branch-misses",
+                                       "context-switches",
+                                       "cpu-migrations" };
+
+        return names[counter];
+    }
+
+    PerfCounters()
+    {
+        for (int i = 0; i != COUNTER_NUMBER; ++i) {
+            m_fd[i] = -1;
+            m_sum[i] = 0.0;
+        }
+
+        m_runs = 0;
+
+#ifdef HAVE_LINUX_PERF_EVENT_H
+        const std::uint32_t types[] = { PERF_TYPE_HARDWARE,
+                                        PERF_TYPE_HARDWARE,
+                                        PERF_TYPE_HARDWARE,
+                                        PERF_TYPE_HARDWARE,
+                                        PERF_TYPE_SOFTWARE,
+                                        PERF_TYPE_SOFTWARE };
+        const std::uint64_t configs[] = { PERF_COUNT_HW_CPU_CYCLES,
+                                          PERF_COUNT_HW_INSTRUCTIONS,
+                                          PERF_COUNT_HW_CACHE_MISSES,
+                                          PERF_COUNT_HW_BRANCH_MISSES,
+                                          PERF_COUNT_SW_CONTEXT_SWITCHES,
+                                          PERF_COUNT_SW_CPU_MIGRATIONS };
+
+        for (int i = 0; i != COUNTER_NUMBER; ++i) {
+            m_fd[i] = open(types[i], configs[i], false);
+
+            /* perf_event_paranoid >= 2 forbids the kernel-space
+             * measurement for unprivileged users. */
+            if (m_fd[i] < 0)
+                m_fd[i] = open(types[i], configs[i], true);
+        }
+#endif
+    }
+
+    ~PerfCounters()
+    {
+#ifdef HAVE_LINUX_PERF_EVENT_H
+        for (int i = 0; i != COUNTER_NUMBER; ++i)
+            if (m_fd[i] >= 0)
+                ::close(m_fd[i]);
+#endif
+    }
+
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    bool available(int counter) const
+    {
+        return m_fd[counter] >= 0;
+    }
+
+    bool available() const
+    {
+        for (int i = 0; i != COUNTER_NUMBER; ++i)
+            if (available(i))
+                return true;
+
+        return false;
+    }
+
+    void start()
+    {
+#ifdef HAVE_LINUX_PERF_EVENT_H
+        for (int i = 0; i != COUNTER_NUMBER; ++i) {
+            if (m_fd[i] >= 0) {
+                ::ioctl(m_fd[i], PERF_EVENT_IOC_RESET, 0);
+                ::ioctl(m_fd[i], PERF_EVENT_IOC_ENABLE, 0);
+            }
+        }
+#endif
+    }
+
+    /**
+     * Stop the counters and add the values of this run to the sums. Values
+     * are scaled if the kernel had to multiplex the counters.
+     */
+    void stop()
+    {
+#ifdef HAVE_LINUX_PERF_EVENT_H
+        for (int i = 0; i != COUNTER_NUMBER; ++i)
+            if (m_fd[i] >= 0)
+                ::ioctl(m_fd[i], PERF_EVENT_IOC_DISABLE, 0);
+
+        for (int i = 0; i != COUNTER_NUMBER; ++i) {
+            if (m_fd[i] < 0)
+                continue;
+
+            std::uint64_t values[3]; /* value, enabled, running. */
+            if (::read(m_fd[i], values, sizeof(values)) !=
+                static_cast <ssize_t>(sizeof(values)))
+                continue;
+
+            double value = static_cast <double>(values[0]);
+            if (values[2] > 0 && values[2] < values[1])
+                value *= static_cast <double>(values[1]) /
+                    static_cast <double>(values[2]);
+
+            m_sum[i] += value;
+        }
+#endif
+        m_runs++;
+    }
+
+    /** Mean value per run of @e counter or -1 if unavailable. */
+    double mean(int counter) const
+    {
+        if (!available(counter) || m_runs == 0)
+            return -1.0;
+
+        return m_sum[counter] / static_cast <double>(m_runs);
+    }
+
+    void clear()
+    {
+        for (int i = 0; i != COUNTER_NUMBER; ++i)
+            m_sum[i] = 0.0;
+
+        m_runs = 0;
+    }
+
+private:
+#ifdef HAVE_LINUX_PERF_EVENT_H
+    static int open(std::uint32_t type, std::uint64_t config,
+                    bool exclude_kernel)
+    {
+        struct perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+
+        attr.size = sizeof(attr);
+        attr.type = type;
+        attr.config = config;
+        attr.disabled = 1;
+        attr.inherit = 1;
+        attr.exclude_hv = 1;
+        attr.exclude_kernel = exclude_kernel ? 1 : 0;
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED |
+            PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+        return static_cast <int>(::syscall(__NR_perf_event_open, &attr, 0,
+                                           -1, -1, 0));
+    }
+#endif
+
+    int m_fd[COUNTER_NUMBER];
+    double m_sum[COUNTER_NUMBER];
+    long int m_runs;
+};
+
+/**
+ * @e PerfScope starts the counters in its constructor and stops them in
+ * its destructor, like @e Timer. A null @e PerfCounters does nothing.
+ */
+struct PerfScope
+{
+    PerfScope(PerfCounters *counters)
+        : m_counters(counters)
+    {
+        if (m_counters)
+            m_counters->start();
+    }
+
+    ~PerfScope()
+    {
+        if (m_counters)
+            m_counters->stop();
+    }
+
+private:
+    PerfCounters *m_counters;
+};
+
+}
+
+#endif
@@ -0,0 +1,342 @@
+/*
+ * Copyright (C) 2014 INRA
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __Benchmark_profiler_hpp__
+#define __Benchmark_profiler_hpp__
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+namespace bench {
+
+/**
+ * @e ProfileClock reads the time stamp counter on x86 (a few cycles per
+ * read) and the steady clock elsewhere. The number of ticks per
+ * millisecond is calibrated once against std::chrono::steady_clock (a 20 ms
+ * loop): the executables call @e ticks_per_millisecond() at startup, before
+ * any timed region.
+ */
+struct ProfileClock
+{
+    static std::uint64_t now()
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#else
+        return static_cast <std::uint64_t>(
+            std::chrono::duration_cast <std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+    }
+
+    static double ticks_per_millisecond()
+    {
+        static const double ret = calibrate();
+
+        return ret;
+    }
+
+    static double milliseconds(std::uint64_t ticks)
+    {
+        return static_cast <double>(ticks) / ticks_per_millisecond();
+    }
+
+private:
+    static double calibrate()
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        auto start = std::chrono::steady_clock::now();
+        std::uint64_t ticks = now();
+        std::chrono::steady_clock::time_point end;
+
+        do {
+            end = std::chrono::steady_clock::now();
+        } while (end - start < std::chrono::milliseconds(20));
+
+        ticks = now() - ticks;
+
+        return static_cast <double>(ticks) /
+            std::chrono::duration <double, std::milli>(end - start).count();
+#else
+        return 1e6;
+#endif
+    }
+};
+
+/**
+ * @e Profiler aggregates the time spent in named regions. Each thread owns
+ * a tree of regions (the path of a region is the names of the enclosing
+ * regions of the thread); a thread only locks its own mutex to create a
+ * node. The trees of all the threads, including the finished ones, are
+ * kept for the reports.
+ */
+class Profiler
+{
+public:
+    struct Node
+    {
+        Node(const char *name, Node *parent)
+            : name(name)
+            , parent(parent)
+            , count(0)
+            , ticks(0)
+        {}
+
+        const char *name;
+        Node *parent;
+        std::vector <std::unique_ptr <Node>> children;
+        std::atomic <std::uint64_t> count;
+        std::atomic <std::uint64_t> ticks;
+    };
+
+    struct Thread
+    {
+        Thread()
+            : root(nullptr, nullptr)
+            , current(&root)
+        {}
+
+        Node root;
+        Node *current;
+        std::mutex mutex;
+    };
+
+    struct Stat
+    {
+        std::uint64_t count = 0;
+        std::uint64_t ticks = 0;
+        unsigned int threads = 0;
+
+        double milliseconds() const
+        {
+            return ProfileClock::milliseconds(ticks);
+        }
+    };
+
+    static Profiler& instance()
+    {
+        static Profiler ret;
+
+        return ret;
+    }
+
+    void enable(bool enable)
+    {
+        m_enabled.store(enable);
+    }
+
+    bool enabled() const
+    {
+        return m_enabled.load(std::memory_order_relaxed);
+    }
+
+    Thread& thread()
+    {
+        static thread_local std::shared_ptr <Thread> ret;
+
+        if (!ret) {
+            ret = std::make_shared <Thread>();
+            std::lock_guard <std::mutex> lock(m_mutex);
+            m_threads.push_back(ret);
+        }
+
+        return *ret;
+    }
+
+    /** Total by region path (`a/b/c'), over all the threads. */
+    std::map <std::string, Stat> paths()
+    {
+        std::map <std::string, Stat> ret;
+
+        visit([&ret](const std::string& path, const Node& node)
+              {
+                  Stat& stat = ret[path];
+                  stat.count += node.count.load(std::memory_order_relaxed);
+                  stat.ticks += node.ticks.load(std::memory_order_relaxed);
+                  stat.threads++;
+              });
+
+        return ret;
+    }
+
+    /** Total by region name, over all the paths and all the threads. */
+    std::map <std::string, Stat> names()
+    {
+        std::map <std::string, Stat> ret;
+
+        visit([&ret](const std::string&, const Node& node)
+              {
+                  Stat& stat = ret[node.name];
+                  stat.count += node.count.load(std::memory_order_relaxed);
+                  stat.ticks += node.ticks.load(std::memory_order_relaxed);
+                  stat.threads++;
+              });
+
+        return ret;
+    }
+
+private:
+    Profiler()
+        : m_enabled(false)
+    {}
+
+    template <typename Function>
+    void visit(Function function)
+    {
+        std::lock_guard <std::mutex> lock(m_mutex);
+
+        for (auto& thread : m_threads) {
+            std::lock_guard <std::mutex> thread_lock(thread->mutex);
+
+            for (auto& child : thread->root.children)
+                visit(function, std::string(), *child);
+        }
+    }
+
+    template <typename Function>
+    void visit(Function& function, const std::string& parent,
+               const Node& node)
+    {
+        std::string path = parent.empty() ? std::string(node.name) :
+            parent + '/' + node.name;
+
+        function(path, node);
+
+        for (auto& child : node.children)
+            visit(function, path, *child);
+    }
+
+    std::vector <std::shared_ptr <Thread>> m_threads;
+    std::mutex m_mutex;
+    std::atomic <bool> m_enabled;
+};
+
+/**
+ * @e ProfileRegion measures a region of code. Regions nest: a region
+ * started while another is open on the same thread is its child. If @e out
+ * is not null, the duration of the region in milliseconds is written into
+ * @e out at the end of the region even if the profiler is not enabled
+ * (like @e Timer). @e name must be a string literal: nodes are searched by
+ * pointer.
+ */
+class ProfileRegion
+{
+public:
+    ProfileRegion()
+        : m_node(nullptr)
+        , m_out(nullptr)
+        , m_start(0)
+    {}
+
+    explicit ProfileRegion(const char *name, double *out = nullptr)
+        : m_node(nullptr)
+        , m_out(nullptr)
+        , m_start(0)
+    {
+        start(name, out);
+    }
+
+    ProfileRegion(const ProfileRegion&) = delete;
+    ProfileRegion& operator=(const ProfileRegion&) = delete;
+
+    ~ProfileRegion()
+    {
+        stop();
+    }
+
+    void start(const char *name, double *out = nullptr)
+    {
+        Profiler& profiler = Profiler::instance();
+
+        m_out = out;
+
+        if (profiler.enabled()) {
+            Profiler::Thread& thread = profiler.thread();
+            Profiler::Node *parent = thread.current;
+
+            for (auto& child : parent->children) {
+                if (child->name == name) {
+                    m_node = child.get();
+                    break;
+                }
+            }
+
+            if (!m_node) {
+                std::lock_guard <std::mutex> lock(thread.mutex);
+                parent->children.emplace_back(new Profiler::Node(name, parent));
+                m_node = parent->children.back().get();
+            }
+
+            thread.current = m_node;
+        }
+
+        if (m_node || m_out)
+            m_start = ProfileClock::now();
+    }
+
+    void stop()
+    {
+        if (!m_node && !m_out)
+            return;
+
+        std::uint64_t ticks = ProfileClock::now() - m_start;
+
+        if (m_node) {
+            m_node->count.store(m_node->count.load(std::memory_order_relaxed) + 1,
+                                std::memory_order_relaxed);
+            m_node->ticks.store(m_node->ticks.load(std::memory_order_relaxed) +
+                                ticks, std::memory_order_relaxed);
+
+            Profiler::instance().thread().current = m_node->parent;
+            m_node = nullptr;
+        }
+
+        if (m_out) {
+            *m_out = ProfileClock::milliseconds(ticks);
+            m_out = nullptr;
+        }
+    }
+
+private:
+    Profiler::Node *m_node;
+    double *m_out;
+    std::uint64_t m_start;
+};
+
+}
+
+#endif
@@ -0,0 +1,352 @@
+/*
+ * Copyright (C) 2014 INRA
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __Benchmark_repartition_hpp__
+#define __Benchmark_repartition_hpp__
+
+#include "critical-path.hpp"
+#include "tgf.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <queue>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace bench {
+
+/**
+ * @e ModelProfile is the measured cost of the atomic models of a topology:
+ * for each vertex, the sum of the costs of its firing transitions in
+ * milliseconds and the number of firings, i.e. the number of messages
+ * sent on each of its output connections, over the profiled runs.
+ */
+struct ModelProfile
+{
+    std::vector <double> cost;
+    std::vector <double> firings;
+
+    /** Add the costs of the last run of @e recorder (see -a). */
+    void add(const Topology& topology, const CostRecorder& recorder)
+    {
+        cost.resize(topology.vertices.size(), 0.0);
+        firings.resize(topology.vertices.size(), 0.0);
+
+        for (std::size_t v = 0, e = topology.vertices.size(); v != e; ++v) {
+            auto it = recorder.m_costs.find(topology.vertices[v].name);
+            if (it == recorder.m_costs.end())
+                continue;
+
+            for (double value : it->second)
+                cost[v] += value;
+            firings[v] += static_cast <double>(it->second.size());
+        }
+    }
+
+    /**
+     * Write `name,type,partition,cost,firings' lines.
+     *
+     * @exception std::runtime_error if the file can not be written.
+     */
+    void write(const Topology& topology, const std::string& filename) const
+    {
+        FILE *file = std::fopen(filename.c_str(), "w");
+        if (!file)
+            throw std::runtime_error(std::string("Profile: failed to write ")
+                                     + filename);
+
+        std::fputs("name,type,partition,cost,firings\n", file);
+
+        for (std::size_t v = 0, e = topology.vertices.size(); v != e; ++v)
+            std::fprintf(file, "%s,%s,%d,%f,%.0f\n",
+                         topology.vertices[v].name.c_str(),
+                         topology.vertices[v].type.c_str(),
+                         topology.vertices[v].partition, cost[v], firings[v]);
+
+        if (std::fclose(file) != 0)
+            throw std::runtime_error(std::string("Profile: failed to write ")
+                                     + filename);
+    }
+};
+
+/** The weight (the sum of @e weight) of each partition of @e assignment. */
+inline std::vector <double> partition_weights(const Topology& topology,
+                                              const std::vector <int>& assignment,
+                                              const std::vector <double>& weight)
+{
+    std::vector <double> ret(topology.partitions(), 0.0);
+
+    for (std::size_t v = 0, e = assignment.size(); v != e; ++v)
+        if (assignment[v] >= 0)
+            ret[assignment[v]] += weight[v];
+
+    return ret;
+}
+
+/** The messages (@e firings of the sources) of the cut connections. */
+inline double weighted_cut(const Topology& topology,
+                           const std::vector <int>& assignment,
+                           const std::vector <double>& firings)
+{
+    double ret = 0.0;
+
+    for (std::size_t v = 0, e = topology.vertices.size(); v != e; ++v)
+        for (int dst : topology.vertices[v].out)
+            if (assignment[v] != assignment[dst])
+                ret += firings[v];
+
+    return ret;
+}
+
+/**
+ * Partition the atomic models of the sub-coupled models of @e topology
+ * into the same number of partitions, with @e profile as weights: the
+ * cost of a model is the weight of its vertex, its firings the weight of
+ * its output connections. The partitions are grown one after the other
+ * from the first free vertex, adding the vertex the most connected to the
+ * partition until it reaches its share of the total cost. Then boundary
+ * vertices move to the neighbour partition that reduces the most the
+ * weighted cut, without going over (1 + @e tolerance) times the share.
+ * The models of the root stay in the root (-1). Linear in the number of
+ * connections by pass.
+ */
+inline std::vector <int> repartition(const Topology& topology,
+                                     const ModelProfile& profile,
+                                     double tolerance = 0.05,
+                                     int passes = 8)
+{
+    const std::size_t size = topology.vertices.size();
+    const int partitions = static_cast <int>(topology.partitions());
+    std::vector <int> ret(size, -1);
+
+    if (partitions == 0)
+        return ret;
+
+    /* Undirected weighted graph of the models of the partitions (CSR). */
+    std::vector <std::size_t> first(size + 1, 0);
+    std::vector <std::pair <int, double>> adjacency;
+
+    for (std::size_t v = 0; v != size; ++v) {
+        if (topology.vertices[v].partition < 0)
+            continue;
+
+        for (int dst : topology.vertices[v].out) {
+            if (topology.vertices[dst].partition < 0 ||
+                dst == static_cast <int>(v))
+                continue;
+
+            first[v + 1]++;
+            first[dst + 1]++;
+        }
+    }
+
+    for (std::size_t v = 0; v != size; ++v)
+        first[v + 1] += first[v];
+
+    adjacency.resize(first[size]);
+
+    {
+        std::vector <std::size_t> next(first.begin(), first.end() - 1);
+
+        for (std::size_t v = 0; v != size; ++v) {
+            if (topology.vertices[v].partition < 0)
+                continue;
+
+            for (int dst : topology.vertices[v].out) {
+                if (topology.vertices[dst].partition < 0 ||
+                    dst == static_cast <int>(v))
+                    continue;
+
+                adjacency[next[v]++] = std::make_pair(dst, profile.firings[v]);
+                adjacency[next[dst]++] = std::make_pair(static_cast <int>(v),
+                                                        profile.firings[v]);
+            }
+        }
+    }
+
+    /* Vertex weights: the measured costs, uniform if nothing is measured.
+     * A small floor keeps the models that never fire from piling up. */
+    std::vector <double> weight(size, 0.0);
+    double total = 0.0;
+    std::size_t models = 0;
+
+    for (std::size_t v = 0; v != size; ++v) {
+        if (topology.vertices[v].partition < 0)
+            continue;
+
+        total += profile.cost[v];
+        models++;
+    }
+
+    if (models == 0)
+        return ret;
+
+    double floor = total > 0.0 ? 1e-3 * total / static_cast <double>(models) :
+        1.0;
+
+    total = 0.0;
+    for (std::size_t v = 0; v != size; ++v) {
+        if (topology.vertices[v].partition < 0)
+            continue;
+
+        weight[v] = profile.cost[v] + floor;
+        total += weight[v];
+    }
+
+    const double share = total / static_cast <double>(partitions);
+    const double limit = (1.0 + tolerance) * share;
+    std::vector <double> load(partitions, 0.0);
+    std::vector <std::size_t> count(partitions, 0);
+
+    /* Graph growing. */
+    {
+        std::vector <double> connection(size, 0.0);
+        std::priority_queue <std::pair <double, int>> queue;
+        std::size_t seed = 0;
+
+        for (int p = 0; p != partitions; ++p) {
+            bool last = p + 1 == partitions;
+
+            while (last || load[p] < share) {
+                int v = -1;
+
+                while (!queue.empty()) {
+                    auto top = queue.top();
+                    queue.pop();
+
+                    if (ret[top.second] < 0 &&
+                        top.first == connection[top.second]) {
+                        v = top.second;
+                        break;
+                    }
+                }
+
+                if (v < 0) {
+                    while (seed != size && (ret[seed] >= 0 ||
+                                            topology.vertices[seed].partition < 0))
+                        ++seed;
+
+                    if (seed == size)
+                        break;
+
+                    v = static_cast <int>(seed);
+                }
+
+                if (!last && count[p] &&
+                    load[p] + weight[v] - share > share - load[p])
+                    break;
+
+                ret[v] = p;
+                load[p] += weight[v];
+                count[p]++;
+
+                for (std::size_t i = first[v]; i != first[v + 1]; ++i) {
+                    int w = adjacency[i].first;
+
+                    if (ret[w] < 0) {
+                        connection[w] += adjacency[i].second;
+                        queue.push(std::make_pair(connection[w], w));
+                    }
+                }
+            }
+
+            /* The candidates of the next partition start from zero. */
+            queue = std::priority_queue <std::pair <double, int>>();
+            for (std::size_t v = 0; v != size; ++v)
+                connection[v] = 0.0;
+        }
+    }
+
+    /* Boundary refinement. */
+    std::vector <double> gain(partitions, 0.0);
+    std::vector <char> mark(partitions, 0);
+    std::vector <int> touched;
+
+    for (int pass = 0; pass != passes; ++pass) {
+        std::size_t moves = 0;
+
+        for (std::size_t v = 0; v != size; ++v) {
+            int from = ret[v];
+            if (from < 0 || count[from] <= 1)
+                continue;
+
+            touched.clear();
+            for (std::size_t i = first[v]; i != first[v + 1]; ++i) {
+                int p = ret[adjacency[i].first];
+
+                if (!mark[p]) {
+                    mark[p] = 1;
+                    touched.push_back(p);
+                }
+                gain[p] += adjacency[i].second;
+            }
+
+            /* A move reduces the weighted cut, or keeps it and improves
+             * the balance, or leaves an overloaded partition. */
+            int best = -1;
+            double best_gain = 0.0;
+
+            for (int p : touched) {
+                if (p == from || load[p] + weight[v] > limit)
+                    continue;
+
+                double g = gain[p] - gain[from];
+
+                if (best < 0 ? (g > 0.0 || load[from] > limit ||
+                                (g == 0.0 && load[from] > load[p] + weight[v]))
+                    : g > best_gain) {
+                    best = p;
+                    best_gain = g;
+                }
+            }
+
+            for (int p : touched) {
+                gain[p] = 0.0;
+                mark[p] = 0;
+            }
+
+            if (best < 0)
+                continue;
+
+            ret[v] = best;
+            load[from] -= weight[v];
+            load[best] += weight[v];
+            count[from]--;
+            count[best]++;
+            moves++;
+        }
+
+        if (moves == 0)
+            break;
+    }
+
+    return ret;
+}
+
+}
+
+#endif
@@ -0,0 +1,379 @@
+/*
+ * Copyright (C) 2014 INRA
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __Benchmark_shm_transport_hpp__
+#define __Benchmark_shm_transport_hpp__
+
+#include <boost/mpi.hpp>
+#include <boost/serialization/vector.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <new>
+#include <thread>
+#include <vector>
+
+namespace bench {
+
+/**
+ * @e ShmRing is a single producer, single consumer ring of messages in
+ * shared memory: a message is its size (8 bytes) followed by its bytes,
+ * copied modulo the capacity. The positions only grow; the producer
+ * publishes a message with a release store of @e head, the consumer frees
+ * it with a release store of @e tail.
+ */
+struct ShmRing
+{
+    alignas(64) std::atomic <std::uint64_t> head;
+    alignas(64) std::atomic <std::uint64_t> tail;
+    alignas(64) char data[1];
+
+    /** A message too large for the ring: the bytes follow by MPI. */
+    static constexpr std::uint64_t elsewhere =
+        std::numeric_limits <std::uint64_t>::max();
+
+    static std::size_t bytes(std::size_t capacity)
+    {
+        return (offsetof(ShmRing, data) + capacity + 63) / 64 * 64;
+    }
+
+    static ShmRing* make(void *memory)
+    {
+        ShmRing *ret = static_cast <ShmRing*>(memory);
+
+        new (&ret->head) std::atomic <std::uint64_t>(0);
+        new (&ret->tail) std::atomic <std::uint64_t>(0);
+
+        return ret;
+    }
+
+    /** Returns false if the ring has not room for @e size bytes. */
+    bool push(const char *message, std::uint64_t size, std::size_t capacity)
+    {
+        std::uint64_t position = head.load(std::memory_order_relaxed);
+        std::uint64_t used = position - tail.load(std::memory_order_acquire);
+        std::uint64_t length = size == elsewhere ? 0 : size;
+
+        if (used + sizeof(size) + length > capacity)
+            return false;
+
+        copy_in(position, reinterpret_cast <const char*>(&size), sizeof(size),
+                capacity);
+        copy_in(position + sizeof(size), message, length, capacity);
+        head.store(position + sizeof(size) + length, std::memory_order_release);
+
+        return true;
+    }
+
+    /** The size of the next message or false if the ring is empty. */
+    bool front(std::uint64_t& size, std::size_t capacity) const
+    {
+        std::uint64_t position = tail.load(std::memory_order_relaxed);
+
+        if (head.load(std::memory_order_acquire) == position)
+            return false;
+
+        copy_out(position, reinterpret_cast <char*>(&size), sizeof(size),
+                 capacity);
+
+        return true;
+    }
+
+    /** Copy the next message (of @e size bytes) and free it. */
+    void pop(char *message, std::uint64_t size, std::size_t capacity)
+    {
+        std::uint64_t position = tail.load(std::memory_order_relaxed);
+        std::uint64_t length = size == elsewhere ? 0 : size;
+
+        copy_out(position + sizeof(size), message, length, capacity);
+        tail.store(position + sizeof(size) + length, std::memory_order_release);
+    }
+
+private:
+    void copy_in(std::uint64_t position, const char *source,
+                 std::size_t size, std::size_t capacity)
+    {
+        std::size_t offset = position % capacity;
+        std::size_t first = std::min(size, capacity - offset);
+
+        std::memcpy(data + offset, source, first);
+        std::memcpy(data, source + first, size - first);
+    }
+
+    void copy_out(std::uint64_t position, char *destination,
+                  std::size_t size, std::size_t capacity) const
+    {
+        std::size_t offset = position % capacity;
+        std::size_t first = std::min(size, capacity - offset);
+
+        std::memcpy(destination, data + offset, first);
+        std::memcpy(destination + first, data, size - first);
+    }
+};
+
+/**
+ * @e ShmTransport connects the ranks of @e comm on the same node with one
+ * @e ShmRing by link (@e sources: ranks sending to this rank,
+ * @e destinations: ranks this rank sends to). The rings of a receiver are
+ * allocated in its segment of an MPI-3 shared memory window of the node.
+ * The links between nodes are not handled: local() is false and the
+ * caller uses MPI. The constructor and the destructor are collective
+ * over @e comm.
+ */
+class ShmTransport
+{
+public:
+    ShmTransport(const boost::mpi::communicator& comm,
+                 const std::vector <int>& sources,
+                 const std::vector <int>& destinations,
+                 std::size_t capacity)
+        : m_capacity(std::max <std::size_t>(capacity, 64))
+        , m_window(MPI_WIN_NULL)
+        , m_in(comm.size(), nullptr)
+        , m_out(comm.size(), nullptr)
+    {
+        MPI_Comm node;
+        MPI_Comm_split_type(comm, MPI_COMM_TYPE_SHARED, comm.rank(),
+                            MPI_INFO_NULL, &node);
+        boost::mpi::communicator local(node, boost::mpi::comm_take_ownership);
+
+        std::vector <int> ranks;
+        boost::mpi::all_gather(local, comm.rank(), ranks);
+
+        std::vector <int> in;
+        for (int source : sources)
+            if (std::find(ranks.begin(), ranks.end(), source) != ranks.end())
+                in.push_back(source);
+
+        std::vector <std::vector <int>> ins;
+        boost::mpi::all_gather(local, in, ins);
+
+        const std::size_t ring = ShmRing::bytes(m_capacity);
+        char *base;
+        MPI_Win_allocate_shared(static_cast <MPI_Aint>(ring * in.size()), 64,
+                                MPI_INFO_NULL, local, &base, &m_window);
+        MPI_Win_lock_all(MPI_MODE_NOCHECK, m_window);
+
+        for (std::size_t i = 0; i != in.size(); ++i)
+            m_in[in[i]] = ShmRing::make(base + ring * i);
+
+        MPI_Win_sync(m_window);
+        local.barrier();
+        MPI_Win_sync(m_window);
+
+        for (int destination : destinations) {
+            auto it = std::find(ranks.begin(), ranks.end(), destination);
+            if (it == ranks.end())
+                continue;
+
+            int peer = static_cast <int>(it - ranks.begin());
+            const auto& list = ins[peer];
+            std::size_t index = std::find(list.begin(), list.end(),
+                                          comm.rank()) - list.begin();
+            MPI_Aint size;
+            int unit;
+            char *segment;
+
+            MPI_Win_shared_query(m_window, peer, &size, &unit, &segment);
+            m_out[destination] = reinterpret_cast <ShmRing*>(
+                segment + ring * index);
+        }
+
+        m_local = local;
+    }
+
+    ShmTransport(const ShmTransport&) = delete;
+    ShmTransport& operator=(const ShmTransport&) = delete;
+
+    ~ShmTransport()
+    {
+        m_local.barrier();
+        MPI_Win_unlock_all(m_window);
+        MPI_Win_free(&m_window);
+    }
+
+    /** Is the link from or to @e rank in shared memory? */
+    bool local_source(int rank) const
+    {
+        return m_in[rank] != nullptr;
+    }
+
+    bool local_destination(int rank) const
+    {
+        return m_out[rank] != nullptr;
+    }
+
+    /**
+     * Push @e size bytes to @e destination, spinning while the ring is full
+     * (the milliseconds are added to @e waited). Returns false if the
+     * message is larger than the ring: a marker is pushed and the caller
+     * sends the bytes by MPI.
+     */
+    template <typename Buffer>
+    bool send(int destination, const Buffer& buffer, double& waited)
+    {
+        ShmRing& ring = *m_out[destination];
+        bool fits = buffer.size() + sizeof(std::uint64_t) <= m_capacity;
+        std::uint64_t size = fits ? buffer.size() : ShmRing::elsewhere;
+
+        if (!ring.push(buffer.data(), size, m_capacity))
+            spin(waited, [&]() {
+                    return ring.push(buffer.data(), size, m_capacity);
+                });
+
+        return fits;
+    }
+
+    /**
+     * Pop the next message of @e source into @e buffer, spinning while the
+     * ring is empty. Returns false if the bytes follow by MPI.
+     */
+    template <typename Buffer>
+    bool receive(int source, Buffer& buffer, double& waited)
+    {
+        ShmRing& ring = *m_in[source];
+        std::uint64_t size;
+
+        if (!ring.front(size, m_capacity))
+            spin(waited, [&]() { return ring.front(size, m_capacity); });
+
+        if (size != ShmRing::elsewhere)
+            buffer.resize(size);
+
+        ring.pop(buffer.data(), size, m_capacity);
+
+        return size != ShmRing::elsewhere;
+    }
+
+private:
+    template <typename Function>
+    static void spin(double& waited, Function ready)
+    {
+        auto start = std::chrono::steady_clock::now();
+
+        for (unsigned int i = 0; !ready(); ++i)
+            if (i > 64)
+                std::this_thread::yield();
+
+        waited += std::chrono::duration <double, std::milli>(
+            std::chrono::steady_clock::now() - start).count();
+    }
+
+    std::size_t m_capacity;
+    MPI_Win m_window;
+    boost::mpi::communicator m_local;
+    std::vector <ShmRing*> m_in;        /* by source rank. */
+    std::vector <ShmRing*> m_out;       /* by destination rank. */
+};
+
+/** Round trip time and throughput of a message size on a transport. */
+struct TransportSample
+{
+    bool shm;
+    std::uint64_t bytes;
+    double latency;                     /* microseconds, half round trip. */
+    double throughput;                  /* megabytes per second. */
+
+    template <typename Archive>
+    void serialize(Archive& ar, const unsigned int)
+    {
+        ar & shm & bytes & latency & throughput;
+    }
+};
+
+/**
+ * Ping-pong between the ranks 0 and 1 of @e comm (collective over
+ * @e comm) for message sizes from 64 bytes to 1 MiB, with MPI and, if the
+ * two ranks are on the same node, with an @e ShmTransport. The samples
+ * are returned on rank 0.
+ */
+inline std::vector <TransportSample> transport_benchmark(
+    const boost::mpi::communicator& comm, std::size_t capacity)
+{
+    const int tag = 4444;
+    const int rank = comm.rank();
+    std::vector <TransportSample> ret;
+    std::vector <int> peer;
+
+    if (rank < 2 && comm.size() > 1)
+        peer.push_back(1 - rank);
+
+    ShmTransport shm(comm, peer, peer, capacity);
+    bool local = rank < 2 && comm.size() > 1 && shm.local_destination(1 - rank);
+
+    if (rank >= 2 || comm.size() < 2)
+        return ret;
+
+    for (std::size_t bytes = 64; bytes <= (1u << 20); bytes *= 4) {
+        std::vector <char> buffer(bytes, 1);
+        int rounds = static_cast <int>(std::max <std::size_t>(
+                10, (64u << 20) / bytes / 16));
+        double waited = 0.0;
+
+        for (int use_shm = 0; use_shm != 1 + local; ++use_shm) {
+            if (rank == 0) {
+                comm.send(1, tag);
+                comm.recv(1, tag);
+            } else {
+                comm.recv(0, tag);
+                comm.send(0, tag);
+            }
+
+            auto start = std::chrono::steady_clock::now();
+
+            for (int round = 0; round != rounds; ++round) {
+                for (int turn = 0; turn != 2; ++turn) {
+                    if (turn == rank) {
+                        if (!use_shm || !shm.send(1 - rank, buffer, waited))
+                            comm.send(1 - rank, tag, buffer);
+                    } else {
+                        if (!use_shm || !shm.receive(1 - rank, buffer, waited))
+                            comm.recv(1 - rank, tag, buffer);
+                    }
+                }
+            }
+
+            double elapsed = std::chrono::duration <double, std::micro>(
+                std::chrono::steady_clock::now() - start).count();
+
+            if (rank == 0)
+                ret.push_back(TransportSample{
+                        use_shm != 0, bytes,
+                        elapsed / (2.0 * rounds),
+                        2.0 * rounds * bytes / elapsed});
+        }
+    }
+
+    return ret;
+}
+
+}
+
+#endif
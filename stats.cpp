@@ -0,0 +1,237 @@
+/*
+ * Copyright (C) 2014 INRA
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "stats.hpp"
+#include <csignal>
+#include <ctime>
+#include <fcntl.h>
+#include <new>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+std::atomic <bench::StatsSegment*> published(nullptr);
+
+/* Async-signal-safe formatting for the SIGUSR1 handler. */
+struct Line
+{
+    char buffer[256];
+    std::size_t size = 0;
+
+    void append(const char *str)
+    {
+        while (*str && size < sizeof(buffer))
+            buffer[size++] = *str++;
+    }
+
+    void append(std::uint64_t value)
+    {
+        char digits[20];
+        int nb = 0;
+
+        do {
+            digits[nb++] = static_cast <char>('0' + value % 10);
+            value /= 10;
+        } while (value);
+
+        while (nb && size < sizeof(buffer))
+            buffer[size++] = digits[--nb];
+    }
+
+    /* Three decimals: enough for the simulated time. */
+    void append(double value)
+    {
+        if (value < 0.0) {
+            append("-");
+            value = -value;
+        }
+
+        std::uint64_t fixed = static_cast <std::uint64_t>(value * 1000.0 + 0.5);
+        std::uint64_t fraction = fixed % 1000;
+
+        append(fixed / 1000);
+        append(".");
+        if (fraction < 100)
+            append("0");
+        if (fraction < 10)
+            append("0");
+        append(fraction);
+    }
+};
+
+void stats_signal(int)
+{
+    bench::StatsSegment *segment = published.load();
+
+    if (segment)
+        bench::stats_dump(*segment, STDERR_FILENO);
+}
+
+}
+
+namespace bench {
+
+std::string stats_name(long int pid)
+{
+    return "/echll-benchmark." + std::to_string(pid);
+}
+
+std::uint64_t stats_now()
+{
+    struct timespec ts;
+
+    ::clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return static_cast <std::uint64_t>(ts.tv_sec) * 1000000000ull +
+        static_cast <std::uint64_t>(ts.tv_nsec);
+}
+
+std::shared_ptr <StatsSegment> stats_publish(const std::string& name)
+{
+    int fd = ::shm_open(name.c_str(), O_CREAT | O_RDWR | O_TRUNC, 0644);
+    if (fd < 0)
+        return nullptr;
+
+    if (::ftruncate(fd, sizeof(StatsSegment)) < 0) {
+        ::close(fd);
+        ::shm_unlink(name.c_str());
+        return nullptr;
+    }
+
+    void *ptr = ::mmap(nullptr, sizeof(StatsSegment), PROT_READ | PROT_WRITE,
+                       MAP_SHARED, fd, 0);
+    ::close(fd);
+
+    if (ptr == MAP_FAILED) {
+        ::shm_unlink(name.c_str());
+        return nullptr;
+    }
+
+    /* The pages of a new segment are zero filled: the counters are zero. */
+    StatsSegment *segment = new (ptr) StatsSegment;
+    segment->pid = static_cast <std::int64_t>(::getpid());
+    segment->replicate_start.store(stats_now());
+    segment->time.store(StatsSegment::to_bits(0.0));
+    segment->magic = stats_magic;
+
+    published.store(segment);
+
+    struct sigaction action;
+    std::memset(&action, 0, sizeof(action));
+    action.sa_handler = stats_signal;
+    action.sa_flags = SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    ::sigaction(SIGUSR1, &action, nullptr);
+
+    return std::shared_ptr <StatsSegment>(
+        segment, [name](StatsSegment *segment)
+        {
+            segment->state.store(StatsSegment::FINISHED);
+            ::signal(SIGUSR1, SIG_DFL);
+            published.store(nullptr);
+            ::munmap(segment, sizeof(StatsSegment));
+            ::shm_unlink(name.c_str());
+        });
+}
+
+std::shared_ptr <const StatsSegment> stats_attach(const std::string& name)
+{
+    int fd = ::shm_open(name.c_str(), O_RDONLY, 0);
+    if (fd < 0)
+        return nullptr;
+
+    struct stat st;
+    if (::fstat(fd, &st) < 0 ||
+        st.st_size < static_cast <off_t>(sizeof(StatsSegment))) {
+        ::close(fd);
+        return nullptr;
+    }
+
+    void *ptr = ::mmap(nullptr, sizeof(StatsSegment), PROT_READ, MAP_SHARED,
+                       fd, 0);
+    ::close(fd);
+
+    if (ptr == MAP_FAILED)
+        return nullptr;
+
+    const StatsSegment *segment = static_cast <const StatsSegment*>(ptr);
+    if (segment->magic != stats_magic) {
+        ::munmap(ptr, sizeof(StatsSegment));
+        return nullptr;
+    }
+
+    return std::shared_ptr <const StatsSegment>(
+        segment, [](const StatsSegment *segment)
+        {
+            ::munmap(const_cast <StatsSegment*>(segment),
+                     sizeof(StatsSegment));
+        });
+}
+
+void stats_replicate(StatsSegment& segment, std::uint64_t file,
+                     std::uint64_t replicate, std::uint64_t replicates,
+                     double begin)
+{
+    segment.file.store(file);
+    segment.replicate.store(replicate);
+    segment.replicates.store(replicates);
+    segment.steps.store(0);
+    segment.time.store(StatsSegment::to_bits(begin));
+    segment.replicate_start.store(stats_now());
+    segment.state.store(StatsSegment::RUNNING);
+}
+
+void stats_dump(const StatsSegment& segment, int fd)
+{
+    Line line;
+    std::uint64_t now = stats_now();
+    std::uint64_t start = segment.replicate_start.load();
+
+    line.append("stats;");
+    line.append(segment.file.load());
+    line.append(";");
+    line.append(segment.replicate.load());
+    line.append(";");
+    line.append(segment.replicates.load());
+    line.append(";");
+    line.append(segment.simulated_time());
+    line.append(";");
+    line.append(segment.steps.load());
+    line.append(";");
+    line.append(segment.transitions());
+    line.append(";");
+    line.append(segment.messages());
+    line.append(";");
+    line.append(static_cast <double>(now > start ? now - start : 0) / 1e6);
+    line.append("\n");
+
+    ssize_t written = ::write(fd, line.buffer, line.size);
+    (void)written;
+}
+
+}
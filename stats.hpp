@@ -0,0 +1,202 @@
+/*
+ * Copyright (C) 2014 INRA
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __Benchmark_stats_hpp__
+#define __Benchmark_stats_hpp__
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+
+namespace bench {
+
+const unsigned int stats_shard_number = 64;
+const std::uint64_t stats_magic = 0x3153424c4c484345ull; /* "ECHLLBS1" */
+
+/** Per thread counters, one per cache line. */
+struct alignas(64) StatsShard
+{
+    std::atomic <std::uint64_t> transitions;
+    std::atomic <std::uint64_t> externals;
+    std::atomic <std::uint64_t> messages;
+};
+
+/**
+ * @e StatsSegment counts the events of the runs: the transitions, the
+ * external events and the messages received by the atomic models and the
+ * steps of the simulation. It is allocated on the heap or, with the live
+ * statistics, it is the layout of a POSIX shared memory segment (see
+ * @e stats_publish). The writers are
+ * the atomic models: a transition is a relaxed increment in the shard of
+ * the thread, the simulated time and the steps are only written when the
+ * time advances. The transitions and the messages are totals since the
+ * start of the process, the time and the steps are reset at each
+ * replicate.
+ */
+struct StatsSegment
+{
+    enum State { IDLE, RUNNING, FINISHED };
+
+    std::uint64_t magic;
+    std::int64_t pid;
+    std::atomic <std::uint64_t> state;
+    std::atomic <std::uint64_t> file;
+    std::atomic <std::uint64_t> replicate;
+    std::atomic <std::uint64_t> replicates;
+    std::atomic <std::uint64_t> replicate_start; /* CLOCK_MONOTONIC, ns */
+    std::atomic <std::uint64_t> steps;
+    std::atomic <std::uint64_t> time;            /* bits of a double */
+    std::atomic <unsigned int> next_shard;
+    StatsShard shards[stats_shard_number];
+
+    StatsShard& shard()
+    {
+        static thread_local int index = -1;
+
+        if (index < 0)
+            index = static_cast <int>(next_shard.fetch_add(1) %
+                                      stats_shard_number);
+
+        return shards[index];
+    }
+
+    void transition(std::uint64_t messages)
+    {
+        StatsShard& s = shard();
+
+        s.transitions.fetch_add(1, std::memory_order_relaxed);
+        if (messages) {
+            s.externals.fetch_add(1, std::memory_order_relaxed);
+            s.messages.fetch_add(messages, std::memory_order_relaxed);
+        }
+    }
+
+    /** Publish the simulated time @e t if it is a new step. */
+    void advance(double t)
+    {
+        std::uint64_t bits = to_bits(t);
+        std::uint64_t current = time.load(std::memory_order_relaxed);
+
+        while (from_bits(current) < t) {
+            if (time.compare_exchange_weak(current, bits,
+                                           std::memory_order_relaxed)) {
+                steps.fetch_add(1, std::memory_order_relaxed);
+                break;
+            }
+        }
+    }
+
+    double simulated_time() const
+    {
+        return from_bits(time.load(std::memory_order_relaxed));
+    }
+
+    std::uint64_t transitions() const
+    {
+        std::uint64_t ret = 0;
+
+        for (const auto& s : shards)
+            ret += s.transitions.load(std::memory_order_relaxed);
+
+        return ret;
+    }
+
+    /** Transitions with at least one message (external events). */
+    std::uint64_t externals() const
+    {
+        std::uint64_t ret = 0;
+
+        for (const auto& s : shards)
+            ret += s.externals.load(std::memory_order_relaxed);
+
+        return ret;
+    }
+
+    std::uint64_t messages() const
+    {
+        std::uint64_t ret = 0;
+
+        for (const auto& s : shards)
+            ret += s.messages.load(std::memory_order_relaxed);
+
+        return ret;
+    }
+
+    static std::uint64_t to_bits(double value)
+    {
+        std::uint64_t ret;
+        std::memcpy(&ret, &value, sizeof(ret));
+
+        return ret;
+    }
+
+    static double from_bits(std::uint64_t value)
+    {
+        double ret;
+        std::memcpy(&ret, &value, sizeof(ret));
+
+        return ret;
+    }
+};
+
+/** The name of the segment of the process @e pid: `/echll-benchmark.pid'. */
+std::string stats_name(long int pid);
+
+/** Monotonic clock in nanoseconds, as stored in @e replicate_start. */
+std::uint64_t stats_now();
+
+/**
+ * Create the segment @e name, install a SIGUSR1 handler that writes a
+ * snapshot of the segment on the standard error output, and return the
+ * segment. The segment is unlinked when the returned pointer is released.
+ * Returns nullptr on failure.
+ */
+std::shared_ptr <StatsSegment> stats_publish(const std::string& name);
+
+/**
+ * Attach read only the segment @e name (for the viewer). Returns nullptr
+ * if the segment does not exist or is not a statistics segment.
+ */
+std::shared_ptr <const StatsSegment> stats_attach(const std::string& name);
+
+/** Start the replicate @e replicate of the file @e file. */
+void stats_replicate(StatsSegment& segment, std::uint64_t file,
+                     std::uint64_t replicate, std::uint64_t replicates,
+                     double begin);
+
+/**
+ * Write the snapshot line
+ * `stats;file;replicate;replicates;time;steps;transitions;messages;elapsed'
+ * into the file descriptor @e fd (async-signal-safe).
+ */
+void stats_dump(const StatsSegment& segment, int fd);
+
+}
+
+#endif
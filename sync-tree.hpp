@@ -0,0 +1,189 @@
+/*
+ * Copyright (C) 2014 INRA
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __Benchmark_sync_tree_hpp__
+#define __Benchmark_sync_tree_hpp__
+
+#include <boost/mpi.hpp>
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+namespace bench {
+
+/**
+ * @e SyncTree computes the minimum of arrays of doubles over the ranks of
+ * a communicator, the synchronization of a time window:
+ * - collective: MPI_Allreduce.
+ * - flat: rank 0 receives the values of every rank and sends back the
+ *   minimum, as a coordinator of all the ranks.
+ * - tree: the ranks are the nodes of a tree of fan-out @e fanout (rank
+ *   @e r has the children @e fanout * r + 1 ... @e fanout * r + fanout):
+ *   the minimum is reduced to rank 0 along the tree and broadcasted back,
+ *   so a rank exchanges with at most @e fanout + 1 ranks by window.
+ */
+class SyncTree
+{
+public:
+    enum Layout { COLLECTIVE, FLAT, TREE };
+
+    SyncTree(const boost::mpi::communicator& comm, Layout layout, int fanout)
+        : m_comm(comm)
+        , m_layout(layout)
+        , m_parent(-1)
+    {
+        const int rank = comm.rank();
+        const int size = comm.size();
+
+        if (layout == FLAT) {
+            if (rank == 0)
+                for (int child = 1; child < size; ++child)
+                    m_children.push_back(child);
+            else
+                m_parent = 0;
+        } else if (layout == TREE) {
+            fanout = std::max(2, fanout);
+
+            if (rank > 0)
+                m_parent = (rank - 1) / fanout;
+
+            for (int i = 1; i <= fanout && fanout * rank + i < size; ++i)
+                m_children.push_back(fanout * rank + i);
+        }
+    }
+
+    /** The minimum of @e local over the ranks, element by element. */
+    void minimum(const double *local, int size, double *global)
+    {
+        if (m_layout == COLLECTIVE) {
+            boost::mpi::all_reduce(m_comm, local, size, global,
+                                   boost::mpi::minimum <double>());
+            return;
+        }
+
+        m_values.resize(size);
+        std::copy(local, local + size, global);
+
+        for (int child : m_children) {
+            m_comm.recv(child, tag, m_values.data(), size);
+
+            for (int i = 0; i != size; ++i)
+                global[i] = std::min(global[i], m_values[i]);
+        }
+
+        if (m_parent >= 0) {
+            m_comm.send(m_parent, tag, global, size);
+            m_comm.recv(m_parent, tag, global, size);
+        }
+
+        for (int child : m_children)
+            m_comm.send(child, tag, global, size);
+    }
+
+    static const char* name(Layout layout)
+    {
+        static const char *names[] = { "collective", "flat", "tree" };
+
+        return names[layout];
+    }
+
+private:
+    static const int tag = 4545;
+
+    boost::mpi::communicator m_comm;
+    Layout m_layout;
+    int m_parent;
+    std::vector <int> m_children;
+    std::vector <double> m_values;
+};
+
+/** Mean latency of a synchronization for a layout and a number of ranks. */
+struct SyncSample
+{
+    int layout;
+    int ranks;
+    int fanout;
+    double latency;                     /* microseconds. */
+
+    template <typename Archive>
+    void serialize(Archive& ar, const unsigned int)
+    {
+        ar & layout & ranks & fanout & latency;
+    }
+};
+
+/**
+ * Time @e rounds synchronizations of 4 values (the reduction of a window)
+ * with each layout on the first 2, 4, 8... ranks of @e comm (collective
+ * over @e comm). The samples are returned on rank 0.
+ */
+inline std::vector <SyncSample> sync_benchmark(
+    const boost::mpi::communicator& comm, int fanout, int rounds = 1000)
+{
+    std::vector <SyncSample> ret;
+    double local[4], global[4];
+
+    if (comm.size() < 2)
+        return ret;
+
+    for (int ranks = 2; ; ranks = std::min(ranks * 2, comm.size())) {
+        bool member = comm.rank() < ranks;
+        boost::mpi::communicator sub = comm.split(member ? 0 : 1);
+
+        for (int layout = SyncTree::COLLECTIVE; member &&
+                 layout <= SyncTree::TREE; ++layout) {
+            SyncTree sync(sub, static_cast <SyncTree::Layout>(layout), fanout);
+
+            std::fill(local, local + 4, static_cast <double>(sub.rank()));
+            sub.barrier();
+            auto start = std::chrono::steady_clock::now();
+
+            for (int round = 0; round != rounds; ++round)
+                sync.minimum(local, 4, global);
+
+            double elapsed = std::chrono::duration <double, std::micro>(
+                std::chrono::steady_clock::now() - start).count();
+            double slowest = 0.0;
+            boost::mpi::reduce(sub, elapsed, slowest,
+                               boost::mpi::maximum <double>(), 0);
+
+            if (comm.rank() == 0)
+                ret.push_back(SyncSample{layout, ranks,
+                            layout == SyncTree::TREE ? std::max(2, fanout) :
+                            layout == SyncTree::FLAT ? ranks - 1 : 0,
+                            slowest / rounds});
+        }
+
+        if (ranks == comm.size())
+            break;
+    }
+
+    return ret;
+}
+
+}
+
+#endif
@@ -0,0 +1,243 @@
+/*
+ * Copyright (C) 2014 INRA
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "defs.hpp"
+#include "linpackc.hpp"
+#include "microbench.hpp"
+#include "models.hpp"
+#include "profiler.hpp"
+#include "tgf.hpp"
+#include "timer.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+
+/*
+ * Microbenchmarks of the building blocks of the benchmark. Each line is:
+ *   microbench;name;batch;samples;median;p10;p90;p99;min
+ * in nanoseconds per operation.
+ */
+
+static std::string write_tgf(std::size_t lines)
+{
+    char filename[] = "/tmp/echll-microbench-XXXXXX";
+    int fd = ::mkstemp(filename);
+    if (fd < 0)
+        throw std::runtime_error("microbench: failed to create a TGF file");
+
+    FILE *file = ::fdopen(fd, "w");
+    std::size_t models = lines / 2;
+
+    for (std::size_t i = 0; i < models; ++i)
+        std::fprintf(file, "%s\n", i ? "normal" : "top");
+
+    std::fprintf(file, "#\n");
+
+    for (std::size_t i = 1; i < lines - models; ++i)
+        std::fprintf(file, "%zu %zu 0 0\n", i, i % models + 1);
+
+    std::fclose(file);
+
+    return filename;
+}
+
+/* The atomic model of the TGF loading: no initialization cost of its
+ * own, so the loading times Echll's reader, factory and connections. */
+struct NoopModel : bench::AtomicModel
+{
+    NoopModel(const vle::Context& ctx)
+        : bench::AtomicModel(ctx, {"0"}, {"0"})
+    {}
+
+    virtual double init(const vle::Common&, const double&) override
+    {
+        return bench::Infinity <double>::positive;
+    }
+
+    virtual double delta(const double&) override
+    {
+        return bench::Infinity <double>::positive;
+    }
+
+    virtual void lambda() const override
+    {}
+};
+
+int main(int argc, char *argv[])
+{
+    bench::Microbench mb;
+    const char *filter = nullptr;
+    int opt;
+
+    while ((opt = ::getopt(argc, argv, "hs:t:")) != -1) {
+        switch (opt) {
+        case 's':
+            mb.samples = std::strtoul(::optarg, nullptr, 10);
+            break;
+        case 't':
+            mb.sample_ms = std::strtod(::optarg, nullptr);
+            break;
+        default:
+            std::fprintf(stdout, "microbench [-s samples][-t sample-ms]"
+                         " [filter]\n");
+            return opt == 'h' ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+    }
+
+    if (::optind < argc)
+        filter = argv[::optind];
+
+    bench::ProfileClock::ticks_per_millisecond();
+
+    auto run = [&mb, filter](const std::string& name, auto function)
+        {
+            if (!filter || name.find(filter) != std::string::npos)
+                bench::Microbench::print(stdout, mb.run(name, function));
+        };
+
+    vle::Context ctx = std::make_shared <vle::ContextImpl>();
+    ctx->set_user_data(10.0);
+
+    vle::Common common;
+    common["duration"] = 0.0;
+    common["name"] = std::string("S0");
+    common["tgf-filesource"] = std::string("S0.tgf");
+    common["tgf-format"] = 1;
+    common["id"] = 0;
+    common["neighbour_number"] = 4u;
+
+    double counter = 0.0;
+
+    run("common-insert", [&common, &counter]()
+        {
+            common.emplace("insert", ++counter);
+            common.erase("insert");
+        });
+
+    run("common-lookup", [&common, &counter]()
+        {
+            counter += boost::any_cast <double>(common.at("duration"));
+            bench::do_not_optimize(counter);
+        });
+
+    run("common-copy", [&common]()
+        {
+            vle::Common copy(common);
+            bench::do_not_optimize(copy);
+        });
+
+    bench::Factory factory;
+    factory.functions.emplace("normal", [&ctx]() -> bench::Factory::modelptr
+                              {
+                                  return bench::Factory::modelptr(
+                                      bench::arena_new <bench::NormalPixel>(ctx));
+                              });
+
+    run("factory-normal", [&factory]()
+        {
+            auto mdl = factory.get("normal");
+            bench::do_not_optimize(mdl.get());
+        });
+
+    {
+        bench::ArenaSet arenas;
+        bench::ArenaScope scope(&arenas);
+
+        run("factory-normal-arena", [&factory]()
+            {
+                auto mdl = factory.get("normal");
+                bench::do_not_optimize(mdl.get());
+            });
+    }
+
+    auto noop = std::make_shared <bench::Factory>();
+    for (const char *type : { "top", "normal" })
+        noop->functions.emplace(type, [&ctx]() -> bench::Factory::modelptr
+                                {
+                                    return bench::Factory::modelptr(
+                                        new NoopModel(ctx));
+                                });
+
+    std::string filename = write_tgf(1000);
+    vle::Common load;
+    load["name"] = std::string("S0");
+    load["id"] = 0;
+    load["tgf-factory"] = noop;
+    load["tgf-source"] = 0;
+    load["tgf-format"] = 1;
+    load["tgf-filesource"] = filename;
+
+    run("tgf-load-1k-lines", [&ctx, &load]()
+        {
+            bench::CoupledMono coupled(ctx);
+            bench::do_not_optimize(coupled.init(load, 0.0));
+        });
+    ::unlink(filename.c_str());
+
+    std::vector <bench::Data> bag;
+    run("bag-push-8-clear", [&bag]()
+        {
+            for (bench::Data i = 0; i < 8; ++i)
+                bag.push_back(i);
+
+            bench::do_not_optimize(bag.data());
+            bag.clear();
+        });
+
+    double duration;
+    run("timer", [&duration]()
+        {
+            {
+                bench::Timer timer(&duration);
+            }
+            bench::do_not_optimize(duration);
+        });
+
+    run("profile-region-disabled", []()
+        {
+            bench::ProfileRegion region("microbench");
+        });
+
+    bench::Profiler::instance().enable(true);
+    run("profile-region", []()
+        {
+            bench::ProfileRegion region("microbench");
+        });
+    bench::Profiler::instance().enable(false);
+
+    run("sleep-and-work-0", []()
+        {
+            bench::sleep_and_work(0.0);
+        });
+
+    run("spin-and-work-10us", []()
+        {
+            bench::spin_and_work(0.01);
+        });
+
+    return EXIT_SUCCESS;
+}
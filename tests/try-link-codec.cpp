@@ -0,0 +1,124 @@
+/*
+ * Copyright (C) 2014 INRA
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "logical-processor.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <stdexcept>
+
+/*
+ * Round-trip the packets of the logical processors through the flat and
+ * the archive formats of LinkCodec, and check that a truncated flat buffer
+ * is refused.
+ */
+
+static bool equal(const bench::LinkPacket& lhs, const bench::LinkPacket& rhs)
+{
+    if (lhs.claims != rhs.claims || lhs.events.size() != rhs.events.size())
+        return false;
+
+    for (std::size_t i = 0, e = lhs.events.size(); i != e; ++i)
+        if (lhs.events[i].time != rhs.events[i].time ||
+            lhs.events[i].port != rhs.events[i].port ||
+            lhs.events[i].values != rhs.events[i].values)
+            return false;
+
+    return true;
+}
+
+static std::vector <bench::LinkPacket> packets()
+{
+    std::vector <bench::LinkPacket> ret(4);
+
+    /* ret[0] is a null message without claim. */
+    ret[1].claims = { { 0, 1.5 }, { 7, 2.0 }, { -1, 1e300 } };
+
+    ret[2].events.push_back(bench::LinkEvent{ 0.25, 3, {} });
+    ret[2].events.push_back(bench::LinkEvent{ 0.25, 4, { 42 } });
+
+    ret[3].claims = { { 2, 10.0 } };
+    ret[3].events.push_back(bench::LinkEvent{ 1.0, 0, { 1, -2, 3, 4, 5 } });
+    ret[3].events.push_back(bench::LinkEvent{ 2.0, 1, {} });
+    ret[3].events.push_back(bench::LinkEvent{ 3.0, 65536, { 0, 1 } });
+
+    return ret;
+}
+
+int main(int argc, char *argv[])
+{
+    boost::mpi::environment env(argc, argv);
+    bench::LogicalProcessorStats stats;
+    bench::LinkCodec flat(true, stats);
+    bench::LinkCodec archive(false, stats);
+    bench::LinkCodec::Buffer buffer;
+    int ret = EXIT_SUCCESS;
+
+    if (!flat.flat() || archive.flat()) {
+        std::printf("link codec: unexpected formats\n");
+        return EXIT_FAILURE;
+    }
+
+    std::vector <bench::LinkPacket> tests = packets();
+
+    for (std::size_t i = 0, e = tests.size(); i != e; ++i) {
+        for (bench::LinkCodec *codec : { &flat, &archive }) {
+            bench::LinkPacket packet;
+
+            /* The packet read is cleared first. */
+            packet.claims.emplace_back(9, 9.0);
+            packet.events.push_back(bench::LinkEvent{ 9.0, 9, { 9 } });
+
+            std::size_t size = codec->write(tests[i], buffer);
+            codec->read(buffer, packet);
+
+            if (size != buffer.size() || !equal(tests[i], packet)) {
+                std::printf("packet %zu: %s round-trip failed\n", i,
+                            codec->flat() ? "flat" : "archive");
+                ret = EXIT_FAILURE;
+            }
+        }
+
+        std::size_t size = flat.write(tests[i], buffer);
+
+        for (std::size_t length = 0; length < size; ++length) {
+            bench::LinkCodec::Buffer truncated(buffer.begin(),
+                                               buffer.begin() + length);
+            bench::LinkPacket packet;
+
+            try {
+                flat.read(truncated, packet);
+                std::printf("packet %zu: truncated to %zu of %zu bytes "
+                            "read\n", i, length, size);
+                ret = EXIT_FAILURE;
+            } catch (const std::runtime_error&) {
+            }
+        }
+    }
+
+    std::printf("link codec: %s\n", ret == EXIT_SUCCESS ? "ok" : "failed");
+
+    return ret;
+}
@@ -24,10 +24,13 @@
  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include "calibration.hpp"
 #include "linpackc.hpp"
 #include "timer.hpp"
+#include <cmath>
 #include <cstdio>
 #include <cstdlib>
+#include <thread>
 
 int main(int argc, char *argv[])
 {
@@ -51,5 +54,41 @@ int main(int argc, char *argv[])
         ret = EXIT_FAILURE;
     }
 
+    const double tolerance = 0.05;
+    bench::Calibration calibration =
+        bench::sleep_and_work_calibrate(stdout, tolerance);
+
+    {
+        bench::Timer t(&diff);
+        for (int i = 0; i < size; ++i)
+            bench::sleep_and_work(duration);
+    }
+
+    std::printf("compensated duration: %.6f\ncompensated mean....: %.6f\n",
+                diff, (diff / size));
+
+    if (calibration.points.empty())
+        ret = EXIT_FAILURE;
+
+    /* The compensated requests last what they ask, spun below the floor.
+     * On a single core, the linpack thread delays the wake up of the
+     * caller by up to a scheduler quantum: the check is skipped. */
+    bool check = std::thread::hardware_concurrency() >= 2;
+    if (!check)
+        std::printf("single core: compensated durations not checked\n");
+
+    for (const auto& point : calibration.points) {
+        double error = (point.median() - point.requested) / point.requested;
+
+        if (!check)
+            continue;
+
+        if (std::abs(error) > tolerance) {
+            std::printf("%f ms: compensated error %f above %f\n",
+                        point.requested, error, tolerance);
+            ret = EXIT_FAILURE;
+        }
+    }
+
     return ret;
 }
@@ -0,0 +1,219 @@
+/*
+ * Copyright (C) 2014 INRA
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "migration.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <stdexcept>
+#include <unistd.h>
+#include <utility>
+
+/*
+ * Migrate the models of a small root TGF file, write the new files, read
+ * them back and check that the flattened graph and the identity of the
+ * models are kept, i.e. that a migration does not change the results.
+ */
+
+typedef std::pair <int, int> Key;       /* root child (-1 for the root), id */
+
+static const char *files[][2] = {
+    { "root.tgf",
+      "coupled\ncoupled\ntop\ncoupled\n#\n"
+      "1 2 1 1\n2 4 2 2\n3 1 0 3\n1 4 4 4\n" },
+    { "S0.tgf",
+      "top\nnormal\nnormal\n#\n"
+      "1 2 0 0\n2 3 0 0\n0 2 3 0\n3 0 0 1\n1 0 0 4\n" },
+    { "S1.tgf",
+      "normal\nnormal\n#\n"
+      "0 1 1 0\n1 2 0 0\n2 0 0 2\n" },
+    { "S3.tgf",
+      "normal\nnormal\nnormal\n#\n"
+      "0 1 2 0\n0 2 4 0\n1 3 0 0\n2 3 0 0\n" }
+};
+
+static std::vector <std::pair <Key, Key>> edges(
+    const bench::Topology& topology, const std::vector <Key>& keys)
+{
+    std::vector <std::pair <Key, Key>> ret;
+
+    for (std::size_t v = 0, e = topology.vertices.size(); v != e; ++v)
+        for (int dst : topology.vertices[v].out)
+            ret.emplace_back(keys[v], keys[dst]);
+
+    std::sort(ret.begin(), ret.end());
+
+    return ret;
+}
+
+static bool check(const char *name, const bench::Migration& migration,
+                  const std::string& directory)
+{
+    const bench::Topology& original = migration.topology();
+    std::shared_ptr <const bench::ModelOrigin> origin =
+        migration.write(directory);
+    bench::Topology topology = bench::topology_read(directory + "root.tgf");
+    std::map <Key, std::size_t> index;
+    std::vector <Key> original_keys, keys;
+    std::vector <int> found(original.vertices.size(), 0);
+    bool ret = true;
+
+    for (std::size_t v = 0, e = original.vertices.size(); v != e; ++v) {
+        const auto& vertex = original.vertices[v];
+        Key key(vertex.partition < 0 ? -1 :
+                original.children[vertex.partition], vertex.id);
+
+        original_keys.push_back(key);
+        index[key] = v;
+    }
+
+    for (const auto& vertex : topology.vertices) {
+        Key key(-1, vertex.id);
+
+        if (vertex.partition >= 0) {
+            int child = topology.children[vertex.partition];
+            const bench::ModelOrigin::Identity *identity =
+                origin->find(child, vertex.id);
+
+            if (!identity) {
+                std::printf("%s: S%d-%d without origin\n", name, child,
+                            vertex.id);
+                return false;
+            }
+
+            key = Key(identity->partition, identity->id);
+        }
+
+        auto it = index.find(key);
+        if (it == index.end()) {
+            std::printf("%s: %s is not an original model\n", name,
+                        vertex.name.c_str());
+            return false;
+        }
+
+        std::size_t v = it->second;
+        int partition = migration.assignment()[v];
+        int child = vertex.partition < 0 ? -1 :
+            topology.children[vertex.partition];
+
+        if (found[v]++ ||
+            original.vertices[v].type != vertex.type ||
+            (partition < 0 ? -1 : original.children[partition]) != child) {
+            std::printf("%s: %s does not match S%d-%d\n", name,
+                        vertex.name.c_str(), key.first, key.second);
+            ret = false;
+        }
+
+        keys.push_back(key);
+    }
+
+    if (topology.vertices.size() != original.vertices.size()) {
+        std::printf("%s: %zu models instead of %zu\n", name,
+                    topology.vertices.size(), original.vertices.size());
+        ret = false;
+    }
+
+    if (ret && edges(topology, keys) != edges(original, original_keys)) {
+        std::printf("%s: the connections differ\n", name);
+        ret = false;
+    }
+
+    if (ret && topology.cut_edges != migration.cut()) {
+        std::printf("%s: cut %zu instead of %zu\n", name, topology.cut_edges,
+                    migration.cut());
+        ret = false;
+    }
+
+    migration.remove(directory);
+
+    std::printf("%s: %s\n", name, ret ? "ok" : "failed");
+
+    return ret;
+}
+
+int main(int argc, char *argv[])
+{
+    (void)argc;
+    (void)argv;
+
+    char input[] = "/tmp/echll-try-migration-XXXXXX";
+    char output[] = "/tmp/echll-try-migration-XXXXXX";
+    int ret = EXIT_SUCCESS;
+
+    if (!::mkdtemp(input) || !::mkdtemp(output))
+        return EXIT_FAILURE;
+
+    const std::string source = std::string(input) + '/';
+    const std::string directory = std::string(output) + '/';
+
+    try {
+        for (const auto& file : files) {
+            FILE *f = std::fopen((source + file[0]).c_str(), "w");
+            if (!f)
+                throw std::runtime_error("failed to write " + source + file[0]);
+
+            std::fputs(file[1], f);
+            std::fclose(f);
+        }
+
+        bench::Migration migration(source + "root.tgf");
+
+        if (!check("identity", migration, directory))
+            ret = EXIT_FAILURE;
+
+        /* Every other atomic model of a partition moves to the next one. */
+        std::vector <int> assignment = migration.assignment();
+        int partitions = static_cast <int>(migration.topology().partitions());
+        for (std::size_t v = 1; v < assignment.size(); v += 2)
+            if (assignment[v] >= 0)
+                assignment[v] = (assignment[v] + 1) % partitions;
+
+        migration.assign(assignment);
+        if (!check("assign", migration, directory))
+            ret = EXIT_FAILURE;
+
+        bench::MigrationPolicy policy;
+        policy.moves = 1.0;
+        if (!migration.plan({ 6.0, 0.0, 0.0 }, policy)) {
+            std::printf("plan: no model moved\n");
+            ret = EXIT_FAILURE;
+        }
+
+        if (!check("plan", migration, directory))
+            ret = EXIT_FAILURE;
+    } catch (const std::exception& e) {
+        std::printf("%s\n", e.what());
+        ret = EXIT_FAILURE;
+    }
+
+    for (const auto& file : files)
+        std::remove((source + file[0]).c_str());
+    ::rmdir(input);
+    ::rmdir(output);
+
+    return ret;
+}
@@ -0,0 +1,353 @@
+/*
+ * Copyright (C) 2014 INRA
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __Benchmark_tgf_hpp__
+#define __Benchmark_tgf_hpp__
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace bench {
+
+/**
+ * @e TGF stores the content of a trivial graph format file as used by the
+ * Echll's generic coupled models: a list of model types, a `#' separator
+ * and a list of edges `source destination source-port destination-port'.
+ * Vertex 0 is the coupled model itself, vertex @e i the model at line @e i.
+ */
+struct TGF
+{
+    struct Edge
+    {
+        int src;
+        int dst;
+        int src_port;
+        int dst_port;
+    };
+
+    std::vector <std::string> models;
+    std::vector <Edge> edges;
+};
+
+/**
+ * Read the TGF file @e filename. The whole file is loaded in memory and
+ * parsed in place to stay fast on million-edge graphs.
+ *
+ * @exception std::invalid_argument if the file can not be read or if an
+ * edge line is malformed.
+ */
+inline TGF tgf_read(const std::string& filename)
+{
+    FILE *file = std::fopen(filename.c_str(), "rb");
+    if (!file)
+        throw std::invalid_argument(std::string("TGF: failed to open ") +
+                                    filename);
+
+    std::vector <char> buffer;
+    {
+        char tmp[65536];
+        std::size_t nb;
+        while ((nb = std::fread(tmp, 1, sizeof(tmp), file)) > 0)
+            buffer.insert(buffer.end(), tmp, tmp + nb);
+
+        /* A directory opens but does not read. */
+        bool error = std::ferror(file);
+        std::fclose(file);
+        if (error)
+            throw std::invalid_argument(std::string("TGF: failed to read ") +
+                                        filename);
+    }
+    buffer.push_back('\0');
+
+    TGF ret;
+    char *it = buffer.data();
+    bool in_edges = false;
+
+    while (*it) {
+        char *eol = std::strchr(it, '\n');
+        if (eol)
+            *eol = '\0';
+
+        char *first = it;
+        while (*first == ' ' || *first == '\t')
+            ++first;
+
+        char *last = first + std::strlen(first);
+        while (last != first && (last[-1] == ' ' || last[-1] == '\t' ||
+                                 last[-1] == '\r'))
+            --last;
+        *last = '\0';
+
+        if (*first) {
+            if (not in_edges) {
+                if (*first == '#')
+                    in_edges = true;
+                else
+                    ret.models.emplace_back(first, last);
+            } else {
+                TGF::Edge edge;
+                char *nptr;
+                int *values[4] = { &edge.src, &edge.dst, &edge.src_port,
+                                   &edge.dst_port };
+
+                for (int *value : values) {
+                    *value = std::strtol(first, &nptr, 10);
+                    if (nptr == first)
+                        throw std::invalid_argument(
+                            std::string("TGF: bad edge in ") + filename);
+                    first = nptr;
+                }
+
+                if (edge.src < 0 || edge.dst < 0 ||
+                    edge.src > static_cast <int>(ret.models.size()) ||
+                    edge.dst > static_cast <int>(ret.models.size()))
+                    throw std::invalid_argument(
+                        std::string("TGF: unknown vertex in ") + filename);
+
+                ret.edges.push_back(edge);
+            }
+        }
+
+        if (!eol)
+            break;
+
+        it = eol + 1;
+    }
+
+    return ret;
+}
+
+/**
+ * Build the path of the TGF file of the sub-coupled model @e child of the
+ * root TGF file @e rootfile. The `S%d.tgf' name used by @e Root is tried
+ * first in the directory of @e rootfile, then the lowercase `s%d.tgf' used
+ * in the examples.
+ */
+inline std::string tgf_child_filename(const std::string& rootfile, int child)
+{
+    std::string dir;
+    std::string::size_type pos = rootfile.find_last_of('/');
+    if (pos != std::string::npos)
+        dir = rootfile.substr(0, pos + 1);
+
+    std::string upper = dir + "S" + std::to_string(child) + ".tgf";
+    if (FILE *file = std::fopen(upper.c_str(), "r")) {
+        std::fclose(file);
+        return upper;
+    }
+
+    return dir + "s" + std::to_string(child) + ".tgf";
+}
+
+/**
+ * @e Topology is the flattened atomic graph of a root TGF file and its
+ * sub-coupled TGF files: every `coupled' model of the root is replaced by
+ * the atomic models of its `S%d.tgf' file and the ports of the coupled
+ * models are resolved into atomic to atomic connections.
+ */
+struct Topology
+{
+    struct Vertex
+    {
+        std::string type;               /* `normal', `top', etc. */
+        std::string name;               /* `S%d' or `S%d-%d' as in Root. */
+        int partition;                  /* -1 for root atomic models. */
+        int id;                         /* index in its coupled model. */
+        std::vector <int> out;          /* one entry per connection. */
+        unsigned int in = 0;            /* number of input connections. */
+    };
+
+    std::vector <Vertex> vertices;
+    std::vector <std::size_t> partition_size;
+    std::vector <int> children;         /* root child of each partition. */
+    std::size_t edges = 0;
+    std::size_t cut_edges = 0;
+
+    std::size_t partitions() const
+    {
+        return partition_size.size();
+    }
+};
+
+inline Topology topology_read(const std::string& rootfile)
+{
+    struct Partition
+    {
+        int first;                      /* first vertex in topology. */
+        std::unordered_multimap <int, int> inputs;  /* port -> atomic. */
+        std::unordered_multimap <int, int> outputs; /* port -> atomic. */
+    };
+
+    Topology ret;
+    TGF root = tgf_read(rootfile);
+    std::vector <int> root_vertex(root.models.size(), -1);
+    std::vector <int> root_partition(root.models.size(), -1);
+    std::vector <Partition> partitions;
+
+    auto connect = [&ret](int src, int dst)
+        {
+            ret.vertices[src].out.push_back(dst);
+            ret.vertices[dst].in++;
+            ret.edges++;
+
+            if (ret.vertices[src].partition != ret.vertices[dst].partition)
+                ret.cut_edges++;
+        };
+
+    for (std::size_t i = 0, e = root.models.size(); i != e; ++i) {
+        int child = static_cast <int>(i);
+
+        if (root.models[i] != "coupled") {
+            root_vertex[i] = static_cast <int>(ret.vertices.size());
+            ret.vertices.emplace_back();
+            ret.vertices.back().type = root.models[i];
+            ret.vertices.back().name = "S" + std::to_string(child);
+            ret.vertices.back().partition = -1;
+            ret.vertices.back().id = child;
+            continue;
+        }
+
+        TGF sub = tgf_read(tgf_child_filename(rootfile, child));
+        Partition partition;
+        partition.first = static_cast <int>(ret.vertices.size());
+
+        for (std::size_t j = 0, f = sub.models.size(); j != f; ++j) {
+            ret.vertices.emplace_back();
+            ret.vertices.back().type = sub.models[j];
+            ret.vertices.back().name = "S" + std::to_string(child) + "-" +
+                std::to_string(j);
+            ret.vertices.back().partition = static_cast <int>(partitions.size());
+            ret.vertices.back().id = static_cast <int>(j);
+        }
+
+        for (const auto& edge : sub.edges) {
+            if (edge.src == 0 && edge.dst != 0)
+                partition.inputs.emplace(edge.src_port,
+                                         partition.first + edge.dst - 1);
+            else if (edge.src != 0 && edge.dst == 0)
+                partition.outputs.emplace(edge.dst_port,
+                                          partition.first + edge.src - 1);
+            else if (edge.src != 0 && edge.dst != 0)
+                connect(partition.first + edge.src - 1,
+                        partition.first + edge.dst - 1);
+        }
+
+        root_partition[i] = static_cast <int>(partitions.size());
+        ret.partition_size.push_back(sub.models.size());
+        ret.children.push_back(child);
+        partitions.push_back(std::move(partition));
+    }
+
+    for (const auto& edge : root.edges) {
+        if (edge.src == 0 || edge.dst == 0)
+            continue;
+
+        std::vector <int> sources, destinations;
+
+        if (root_partition[edge.src - 1] >= 0) {
+            auto range = partitions[root_partition[edge.src - 1]].outputs
+                .equal_range(edge.src_port);
+            for (auto it = range.first; it != range.second; ++it)
+                sources.push_back(it->second);
+        } else {
+            sources.push_back(root_vertex[edge.src - 1]);
+        }
+
+        if (root_partition[edge.dst - 1] >= 0) {
+            auto range = partitions[root_partition[edge.dst - 1]].inputs
+                .equal_range(edge.dst_port);
+            for (auto it = range.first; it != range.second; ++it)
+                destinations.push_back(it->second);
+        } else {
+            destinations.push_back(root_vertex[edge.dst - 1]);
+        }
+
+        for (int src : sources)
+            for (int dst : destinations)
+                connect(src, dst);
+    }
+
+    return ret;
+}
+
+/**
+ * Kahn's topological order of a graph of @e size vertices where
+ * @e successors(v) is the list of the successors of the vertex @e v. The
+ * order is shorter than @e size if the graph has a cycle.
+ */
+template <typename Successors>
+inline std::vector <int> topological_order(std::size_t size,
+                                           const Successors& successors)
+{
+    std::vector <unsigned int> degree(size, 0);
+    std::vector <int> ret;
+
+    ret.reserve(size);
+
+    for (std::size_t v = 0; v != size; ++v)
+        for (int dst : successors(static_cast <int>(v)))
+            degree[dst]++;
+
+    for (std::size_t v = 0; v != size; ++v)
+        if (degree[v] == 0)
+            ret.push_back(static_cast <int>(v));
+
+    for (std::size_t i = 0; i != ret.size(); ++i)
+        for (int dst : successors(ret[i]))
+            if (--degree[dst] == 0)
+                ret.push_back(dst);
+
+    return ret;
+}
+
+/** The topological order of the atomic models of @e topology. */
+inline std::vector <int> topological_order(const Topology& topology)
+{
+    return topological_order(topology.vertices.size(),
+                             [&topology](int v) -> const std::vector <int>&
+                             {
+                                 return topology.vertices[v].out;
+                             });
+}
+
+/**
+ * Returns true if the atomic graph of @e topology has no cycle, i.e. if the
+ * messages of a time can not wait for themselves through the ports of the
+ * sub-coupled models.
+ */
+inline bool topology_acyclic(const Topology& topology)
+{
+    return topological_order(topology).size() == topology.vertices.size();
+}
+
+}
+
+#endif
@@ -0,0 +1,269 @@
+/*
+ * Copyright (C) 2014 INRA
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __Benchmark_trace_hpp__
+#define __Benchmark_trace_hpp__
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace bench {
+
+/** One measured transition: cost in microseconds of a model at a step. */
+struct TraceRecord
+{
+    std::uint32_t partition;
+    std::uint32_t id;
+    std::uint32_t step;
+    float cost;
+};
+
+inline bool operator<(const TraceRecord& lhs, const TraceRecord& rhs)
+{
+    return std::tie(lhs.partition, lhs.id, lhs.step) <
+        std::tie(rhs.partition, rhs.id, rhs.step);
+}
+
+/** Header of the binary traces: the magic then the number of records. */
+const char trace_magic[8] = { 'E', 'C', 'H', 'L', 'T', 'R', 'C', '1' };
+
+/**
+ * @e Trace gives to each atomic model the sequence of the costs of its
+ * transitions. A binary trace (@e trace_magic, the number of records then
+ * the records sorted by partition, id and step) is mapped in memory; a CSV
+ * trace (`partition,id,step,cost' or `Sp-i,step,cost' lines, costs in
+ * microseconds) is read and sorted in memory: convert large traces with
+ * @e trace_write.
+ */
+class Trace
+{
+public:
+    typedef std::pair <const TraceRecord*, const TraceRecord*> range;
+
+    Trace(const Trace&) = delete;
+    Trace& operator=(const Trace&) = delete;
+
+    /** @exception std::invalid_argument if the trace can not be read. */
+    explicit Trace(const std::string& filename)
+        : m_map(nullptr)
+        , m_map_size(0)
+        , m_begin(nullptr)
+        , m_end(nullptr)
+    {
+        int fd = ::open(filename.c_str(), O_RDONLY);
+        if (fd < 0)
+            throw std::invalid_argument("Trace: failed to open " + filename);
+
+        struct stat st;
+        char magic[sizeof(trace_magic)] = { 0 };
+
+        if (::fstat(fd, &st) < 0 ||
+            ::read(fd, magic, sizeof(magic)) < 0) {
+            ::close(fd);
+            throw std::invalid_argument("Trace: failed to read " + filename);
+        }
+
+        try {
+            if (std::memcmp(magic, trace_magic, sizeof(magic)) == 0)
+                map(fd, static_cast <std::size_t>(st.st_size), filename);
+        } catch (...) {
+            ::close(fd);
+            throw;
+        }
+
+        ::close(fd);
+
+        if (!m_map)
+            read_csv(filename);
+    }
+
+    ~Trace()
+    {
+        if (m_map)
+            ::munmap(m_map, m_map_size);
+    }
+
+    std::size_t size() const
+    {
+        return static_cast <std::size_t>(m_end - m_begin);
+    }
+
+    const TraceRecord* begin() const
+    {
+        return m_begin;
+    }
+
+    const TraceRecord* end() const
+    {
+        return m_end;
+    }
+
+    /** The records of a model, empty if the model is not in the trace. */
+    range find(int partition, int id) const
+    {
+        TraceRecord first = { static_cast <std::uint32_t>(partition),
+                              static_cast <std::uint32_t>(id), 0, 0.0f };
+        TraceRecord last = { static_cast <std::uint32_t>(partition),
+                             static_cast <std::uint32_t>(id) + 1, 0, 0.0f };
+
+        return range(std::lower_bound(m_begin, m_end, first),
+                     std::lower_bound(m_begin, m_end, last));
+    }
+
+private:
+    void map(int fd, std::size_t size, const std::string& filename)
+    {
+        const std::size_t header = sizeof(trace_magic) + sizeof(std::uint64_t);
+        std::uint64_t count;
+
+        if (size < header ||
+            ::pread(fd, &count, sizeof(count), sizeof(trace_magic)) !=
+            sizeof(count) ||
+            count > (size - header) / sizeof(TraceRecord))
+            throw std::invalid_argument("Trace: truncated file " + filename);
+
+        void *ptr = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+        if (ptr == MAP_FAILED)
+            throw std::invalid_argument("Trace: failed to map " + filename);
+
+        m_map = ptr;
+        m_map_size = size;
+        m_begin = reinterpret_cast <const TraceRecord*>(
+            static_cast <const char*>(ptr) + header);
+        m_end = m_begin + count;
+
+        if (!std::is_sorted(m_begin, m_end)) {
+            ::munmap(m_map, m_map_size);
+            m_map = nullptr;
+            m_begin = m_end = nullptr;
+            throw std::invalid_argument("Trace: unsorted records in " +
+                                        filename);
+        }
+    }
+
+    void read_csv(const std::string& filename)
+    {
+        FILE *file = std::fopen(filename.c_str(), "r");
+        if (!file)
+            throw std::invalid_argument("Trace: failed to open " + filename);
+
+        char line[256];
+        while (std::fgets(line, sizeof(line), file)) {
+            TraceRecord record;
+            unsigned long partition, id, step;
+            double cost;
+
+            if (std::sscanf(line, " S%lu-%lu , %lu , %lf", &partition, &id,
+                            &step, &cost) != 4 &&
+                std::sscanf(line, " %lu , %lu , %lu , %lf", &partition, &id,
+                            &step, &cost) != 4)
+                continue;       /* comments and header lines. */
+
+            record.partition = static_cast <std::uint32_t>(partition);
+            record.id = static_cast <std::uint32_t>(id);
+            record.step = static_cast <std::uint32_t>(step);
+            record.cost = static_cast <float>(cost);
+            m_records.push_back(record);
+        }
+
+        std::fclose(file);
+
+        std::stable_sort(m_records.begin(), m_records.end());
+        m_begin = m_records.data();
+        m_end = m_begin + m_records.size();
+    }
+
+    void *m_map;
+    std::size_t m_map_size;
+    std::vector <TraceRecord> m_records;
+    const TraceRecord *m_begin;
+    const TraceRecord *m_end;
+};
+
+/**
+ * Write the records of @e trace into the binary trace @e filename.
+ *
+ * @exception std::invalid_argument if the file can not be written.
+ */
+inline void trace_write(const Trace& trace, const std::string& filename)
+{
+    FILE *file = std::fopen(filename.c_str(), "wb");
+    if (!file)
+        throw std::invalid_argument("Trace: failed to create " + filename);
+
+    std::uint64_t count = trace.size();
+    bool ok = std::fwrite(trace_magic, sizeof(trace_magic), 1, file) == 1 &&
+        std::fwrite(&count, sizeof(count), 1, file) == 1 &&
+        std::fwrite(trace.begin(), sizeof(TraceRecord), trace.size(), file) ==
+        trace.size();
+
+    if (std::fclose(file) != 0 || !ok)
+        throw std::invalid_argument("Trace: failed to write " + filename);
+}
+
+/**
+ * @e TraceCursor walks the records of one model, step after step. The cost
+ * of a step is the sum of the records of the step (0 if none).
+ */
+struct TraceCursor
+{
+    const TraceRecord *next = nullptr;
+    const TraceRecord *end = nullptr;
+
+    bool empty() const
+    {
+        return next == nullptr;
+    }
+
+    /** Cost in milliseconds of the step @e step. */
+    double cost(std::uint32_t step)
+    {
+        double ret = 0.0;
+
+        while (next != end && next->step < step)
+            ++next;
+
+        while (next != end && next->step == step)
+            ret += static_cast <double>((next++)->cost);
+
+        return ret / 1000.0;
+    }
+};
+
+}
+
+#endif
@@ -0,0 +1,316 @@
+/*
+ * Copyright (C) 2014 INRA
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __Benchmark_workload_hpp__
+#define __Benchmark_workload_hpp__
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace bench {
+
+/** splitmix64: a 8 bytes generator, small enough for one per model. */
+inline std::uint64_t random_next(std::uint64_t& state)
+{
+    std::uint64_t z = (state += 0x9e3779b97f4a7c15ull);
+
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+
+    return z ^ (z >> 31);
+}
+
+/** Uniform in (0, 1). */
+inline double random_uniform(std::uint64_t& state)
+{
+    return (static_cast <double>(random_next(state) >> 11) + 0.5) *
+        (1.0 / 9007199254740992.0);
+}
+
+/**
+ * The initial state of the generator of the model @e id of the partition
+ * @e partition: runs are reproducible whatever the order of the
+ * initializations.
+ */
+inline std::uint64_t random_seed(std::uint64_t seed, int partition, int id)
+{
+    std::uint64_t ret = seed ^ (static_cast <std::uint64_t>(
+            static_cast <std::uint32_t>(partition)) << 32) ^
+        static_cast <std::uint32_t>(id);
+
+    random_next(ret);
+
+    return ret;
+}
+
+/**
+ * @e CostDistribution draws the cost of the transitions of a model, in
+ * milliseconds, with @e mean the duration of the -d option:
+ * - constant: @e mean.
+ * - uniform: uniform in [mean * (1 - spread), mean * (1 + spread)].
+ * - exponential: exponential of mean @e mean.
+ * - lognormal: lognormal of mean @e mean and shape @e sigma.
+ * - hotspot: @e mean * @e factor with the probability @e ratio, @e mean
+ *   otherwise.
+ * - skewed: @e mean * (1 + @e skew * partition).
+ * The cost of a model is drawn once from a generator seeded with @e seed,
+ * the partition and the identifier of the model, so a run is reproducible
+ * whatever the order of the initializations. With @e per_transition, each
+ * transition draws a new cost from the generator of the model.
+ */
+struct CostDistribution
+{
+    enum Type { CONSTANT, UNIFORM, EXPONENTIAL, LOGNORMAL, HOTSPOT, SKEWED };
+
+    Type type = CONSTANT;
+    double mean = 0.0;
+    double spread = 1.0;
+    double sigma = 1.0;
+    double ratio = 0.1;
+    double factor = 10.0;
+    double skew = 1.0;
+    std::uint64_t seed = 0;
+    bool per_transition = false;
+
+    /**
+     * Read `name[,key=value...][,per-transition]' where the keys are
+     * spread, sigma, ratio, factor, skew and seed. Returns false on error.
+     */
+    bool parse(const std::string& spec)
+    {
+        std::size_t begin = 0;
+        bool first = true;
+
+        while (begin <= spec.size()) {
+            std::size_t end = spec.find(',', begin);
+            if (end == std::string::npos)
+                end = spec.size();
+
+            std::string token = spec.substr(begin, end - begin);
+            begin = end + 1;
+
+            if (first) {
+                first = false;
+
+                if (token == "constant")
+                    type = CONSTANT;
+                else if (token == "uniform")
+                    type = UNIFORM;
+                else if (token == "exponential")
+                    type = EXPONENTIAL;
+                else if (token == "lognormal")
+                    type = LOGNORMAL;
+                else if (token == "hotspot")
+                    type = HOTSPOT;
+                else if (token == "skewed")
+                    type = SKEWED;
+                else
+                    return false;
+
+                continue;
+            }
+
+            if (token == "per-transition") {
+                per_transition = true;
+                continue;
+            }
+
+            std::size_t equal = token.find('=');
+            if (equal == std::string::npos)
+                return false;
+
+            std::string key = token.substr(0, equal);
+            const char *value = token.c_str() + equal + 1;
+            char *nptr;
+            double number = std::strtod(value, &nptr);
+            if (nptr == value || *nptr != '\0' || number < 0.0)
+                return false;
+
+            if (key == "spread")
+                spread = std::min(number, 1.0);
+            else if (key == "sigma")
+                sigma = number;
+            else if (key == "ratio")
+                ratio = std::min(number, 1.0);
+            else if (key == "factor")
+                factor = number;
+            else if (key == "skew")
+                skew = number;
+            else if (key == "seed")
+                seed = static_cast <std::uint64_t>(number);
+            else
+                return false;
+        }
+
+        return true;
+    }
+
+    const char* name() const
+    {
+        static const char *names[] = { "constant", "uniform", "exponential",
+                                       "lognormal", "hotspot", "skewed" };
+
+        return names[type];
+    }
+
+    /** The initial state of the generator of a model. */
+    std::uint64_t state(int partition, int id) const
+    {
+        return random_seed(seed, partition, id);
+    }
+
+    double draw(std::uint64_t& state, int partition) const
+    {
+        switch (type) {
+        case CONSTANT:
+            return mean;
+        case UNIFORM:
+            return mean * (1.0 - spread + 2.0 * spread * random_uniform(state));
+        case EXPONENTIAL:
+            return -mean * std::log(random_uniform(state));
+        case LOGNORMAL:
+            {
+                double u1 = random_uniform(state);
+                double u2 = random_uniform(state);
+                double normal = std::sqrt(-2.0 * std::log(u1)) *
+                    std::cos(6.283185307179586 * u2);
+
+                return mean * std::exp(sigma * normal - sigma * sigma / 2.0);
+            }
+        case HOTSPOT:
+            return random_uniform(state) < ratio ? mean * factor : mean;
+        case SKEWED:
+            return mean * (1.0 + skew * std::max(0, partition));
+        }
+
+        return mean;
+    }
+};
+
+/**
+ * @e WorkloadStats sums the cost of the transitions (in nanoseconds) and
+ * the number of models of each partition (the `workload' parameter). A
+ * sub-coupled model takes the slot of its partition once and gives it to
+ * its children.
+ */
+class WorkloadStats
+{
+public:
+    struct Slot
+    {
+        std::atomic <std::uint64_t> models;
+        std::atomic <std::uint64_t> work;
+
+        Slot()
+            : models(0)
+            , work(0)
+        {}
+
+        void add(double cost)
+        {
+            work.fetch_add(static_cast <std::uint64_t>(cost * 1e6),
+                           std::memory_order_relaxed);
+        }
+    };
+
+    Slot* slot(int partition)
+    {
+        std::lock_guard <std::mutex> lock(m_mutex);
+
+        std::unique_ptr <Slot>& ret = m_slots[partition];
+        if (!ret)
+            ret.reset(new Slot());
+
+        return ret.get();
+    }
+
+    void clear()
+    {
+        std::lock_guard <std::mutex> lock(m_mutex);
+
+        for (auto& slot : m_slots) {
+            slot.second->models.store(0);
+            slot.second->work.store(0);
+        }
+    }
+
+    /** Add the work of the run into @e total (milliseconds by partition). */
+    void accumulate(std::map <int, std::pair <double, double>>& total)
+    {
+        std::lock_guard <std::mutex> lock(m_mutex);
+
+        for (auto& slot : m_slots) {
+            auto& value = total[slot.first];
+            value.first += static_cast <double>(slot.second->models.load());
+            value.second += static_cast <double>(slot.second->work.load()) / 1e6;
+        }
+    }
+
+private:
+    std::map <int, std::unique_ptr <Slot>> m_slots;
+    std::mutex m_mutex;
+};
+
+/**
+ * Writes, from the totals of @e counter runs, the mean per run:
+ *   workload;partition;models;work
+ *   workload-imbalance;partitions;total;max;mean;imbalance
+ * where imbalance is max / mean of the work of the partitions.
+ */
+inline void workload_print(FILE *output,
+                           const std::map <int, std::pair <double, double>>& total,
+                           long int counter)
+{
+    double n = static_cast <double>(counter);
+    double sum = 0.0, max = 0.0;
+
+    for (const auto& partition : total) {
+        double work = partition.second.second / n;
+
+        std::fprintf(output, "workload;%d;%f;%f\n", partition.first,
+                     partition.second.first / n, work);
+
+        sum += work;
+        max = std::max(max, work);
+    }
+
+    double mean = total.empty() ? 0.0 : sum / static_cast <double>(total.size());
+
+    std::fprintf(output, "workload-imbalance;%zu;%f;%f;%f;%f\n", total.size(),
+                 sum, max, mean, mean > 0.0 ? max / mean : 0.0);
+}
+
+}
+
+#endif